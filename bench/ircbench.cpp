@@ -0,0 +1,697 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ircbench.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/14 13:05:51 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/14 13:05:51 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// ircserv の負荷試験クライアント（make bench で起動する）
+// 多数の接続を張って PASS / NICK / USER で登録し、JOIN / PRIVMSG / MODE を混ぜて送り続ける。
+// チャンネル宛ての PRIVMSG には送信時刻を埋め込み、受け取った全員の側で配送遅延を測る。
+
+#include "irc.hpp"
+#include "event_loop.hpp"
+#include "line_buffer.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <netinet/tcp.h>  //-> for TCP_NODELAY
+#include <sys/resource.h> //-> for setrlimit()
+#include <sys/wait.h>     //-> for waitpid()
+
+#define BENCH_MARKER ":bench "   //-> 遅延測定用メッセージの目印（この後ろに送信時刻が続く）
+#define CONNECT_BATCH 256        //-> 1 ループで開始する接続の数
+#define SETUP_TIMEOUT 30000000UL //-> 登録と JOIN を待つ最大時間 (us)
+#define DRAIN_TIME 1000000UL     //-> 送信を止めた後、届き終わるのを待つ時間 (us)
+
+struct BenchConfig
+{
+    std::string host;
+    int port;
+    std::string password;
+    size_t clients;  //-> 接続数
+    size_t channels; //-> チャンネル数（接続は順番に 1 つずつ割り当てる）
+    size_t duration; //-> 測定時間 (秒)
+    size_t rate;     //-> 1 接続あたりの毎秒コマンド数
+    size_t size;     //-> PRIVMSG 本文の大きさ (バイト)
+    size_t mix_privmsg; //-> 以下 4 つはコマンドの比率
+    size_t mix_direct;
+    size_t mix_join;
+    size_t mix_mode;
+    pid_t server_pid;                    //-> RSS を測るサーバーのプロセス (0 なら測らない)
+    std::vector<std::string> server_cmd; //-> 指定されていればこのコマンドでサーバーを起動する
+
+    BenchConfig()
+        : host("127.0.0.1"), port(6667), password(""), clients(1000), channels(10), duration(10), rate(1),
+          size(64), mix_privmsg(90), mix_direct(4), mix_join(3), mix_mode(3), server_pid(0) {}
+};
+
+// 配送遅延のヒストグラム
+// 2 のべき乗ごとの区間を 16 分割して数えるので、全サンプルを持たずに誤差 6% 程度で百分位を出せる
+class LatencyHistogram
+{
+private:
+    std::vector<unsigned long> _buckets;
+    unsigned long _count;
+    unsigned long _max;
+
+    static size_t bucketOf(unsigned long us)
+    {
+        if (us < 16)
+            return us;
+        int exp = 63 - __builtin_clzl(us); //-> 最上位ビットの位置 (4 以上)
+        return 16 + (exp - 4) * 16 + ((us >> (exp - 4)) & 15);
+    }
+    static unsigned long upperBound(size_t bucket)
+    {
+        if (bucket < 16)
+            return bucket;
+        int exp = (bucket - 16) / 16 + 4;
+        unsigned long low = (16 + (bucket - 16) % 16) << (exp - 4);
+        return low + (1UL << (exp - 4)) - 1;
+    }
+
+public:
+    LatencyHistogram() : _buckets(16 + 60 * 16, 0), _count(0), _max(0) {}
+
+    void record(unsigned long us)
+    {
+        _buckets[bucketOf(us)]++;
+        _count++;
+        if (us > _max)
+            _max = us;
+    }
+    unsigned long count() const { return _count; }
+    unsigned long max() const { return _max; }
+
+    // p (0〜1) 番目の値を含むバケットの上限を返す
+    unsigned long percentile(double p) const
+    {
+        if (_count == 0)
+            return 0;
+        unsigned long rank = static_cast<unsigned long>(p * (_count - 1)) + 1;
+        unsigned long seen = 0;
+        for (size_t i = 0; i < _buckets.size(); i++)
+        {
+            seen += _buckets[i];
+            if (seen >= rank)
+                return std::min(upperBound(i), _max);
+        }
+        return _max;
+    }
+};
+
+enum BenchState
+{
+    BENCH_CONNECTING,
+    BENCH_REGISTERING,
+    BENCH_JOINING,
+    BENCH_RUNNING,
+    BENCH_DEAD
+};
+
+// 負荷をかける接続 1 本分
+struct BenchClient
+{
+    int fd;
+    BenchState state;
+    std::string nick;
+    size_t home;        //-> 常に参加しているチャンネル
+    LineBuffer in;      //-> 受信した行（サーバーと同じフレーマを使う）
+    std::string out;    //-> 送り切れなかった分
+    bool want_write;    //-> 書き込み監視を登録中
+
+    BenchClient() : fd(-1), state(BENCH_CONNECTING), home(0), want_write(false) {}
+};
+
+struct BenchStats
+{
+    unsigned long sent;      //-> 送ったコマンド数（測定中のみ）
+    unsigned long delivered; //-> 受け取った測定用メッセージ数
+    unsigned long errors;    //-> 4xx / 5xx の返信数
+    unsigned long dead;      //-> 切断された接続数
+
+    BenchStats() : sent(0), delivered(0), errors(0), dead(0) {}
+};
+
+class Bench
+{
+private:
+    BenchConfig _config;
+    EventLoop *_loop;
+    std::vector<BenchClient> _clients;
+    std::vector<int> _by_fd; //-> fd → _clients の添字
+    std::vector<IoEvent> _events;
+    LatencyHistogram _latency;
+    BenchStats _stats;
+    size_t _running;         //-> JOIN まで済んだ接続数
+    bool _measuring;         //-> 測定中（遅延と送信数を数える）
+    std::string _padding;    //-> PRIVMSG 本文の詰め物
+    pid_t _spawned;          //-> 自分で起動したサーバー
+
+    Bench(const Bench &other);
+    Bench &operator=(const Bench &other);
+
+    void spawnServer();
+    void stopServer();
+    void waitForServer();
+    void connectClient(size_t index);
+    void finishConnect(BenchClient &client);
+    void sendLine(BenchClient &client, const std::string &line);
+    void flush(BenchClient &client);
+    void readClient(BenchClient &client);
+    void handleLine(BenchClient &client, const StringView &line);
+    void disconnect(BenchClient &client);
+    void pollOnce(int timeout_ms);
+    void sendCommand(BenchClient &client);
+    size_t serverRss(const char *field) const;
+
+public:
+    Bench(const BenchConfig &config);
+    ~Bench();
+
+    int run();
+};
+
+Bench::Bench(const BenchConfig &config)
+    : _config(config), _loop(NULL), _running(0), _measuring(false), _spawned(0)
+{
+    _loop = EventLoop::create("");
+    _clients.resize(_config.clients);
+    _padding.assign(_config.size > 32 ? _config.size - 32 : 0, 'x');
+}
+
+Bench::~Bench()
+{
+    for (size_t i = 0; i < _clients.size(); i++)
+    {
+        if (_clients[i].fd != -1)
+            close(_clients[i].fd);
+    }
+    delete _loop;
+    stopServer();
+}
+
+void Bench::spawnServer()
+{
+    if (_config.server_cmd.empty())
+        return;
+    std::vector<char *> argv;
+    for (size_t i = 0; i < _config.server_cmd.size(); i++)
+        argv.push_back(const_cast<char *>(_config.server_cmd[i].c_str()));
+    argv.push_back(NULL);
+    _spawned = fork();
+    if (_spawned == -1)
+        throw std::runtime_error("fork() failed");
+    if (_spawned == 0)
+    {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull != -1)
+        {
+            dup2(devnull, STDOUT_FILENO); //-> サーバーの接続ログで結果が埋もれないようにする
+            close(devnull);
+        }
+        execv(argv[0], &argv[0]);
+        _exit(127);
+    }
+    _config.server_pid = _spawned;
+}
+
+void Bench::stopServer()
+{
+    if (_spawned <= 0)
+        return;
+    ::kill(_spawned, SIGINT);
+    waitpid(_spawned, NULL, 0);
+    _spawned = 0;
+}
+
+// サーバーが接続を受け付けるようになるまで待つ
+void Bench::waitForServer()
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_config.port);
+    inet_pton(AF_INET, _config.host.c_str(), &addr.sin_addr);
+    for (int i = 0; i < 100; i++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int ret = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+        close(fd);
+        if (ret == 0)
+            return;
+        if (_spawned && waitpid(_spawned, NULL, WNOHANG) == _spawned)
+        {
+            _spawned = 0;
+            throw std::runtime_error("server exited during startup");
+        }
+        usleep(100000);
+    }
+    throw std::runtime_error("server is not accepting connections");
+}
+
+void Bench::connectClient(size_t index)
+{
+    BenchClient &client = _clients[index];
+    client.state = BENCH_CONNECTING;
+    client.home = index % _config.channels;
+    client.want_write = true;
+    std::ostringstream nick;
+    nick << "b" << index;
+    client.nick = nick.str();
+
+    client.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (client.fd == -1)
+        throw std::runtime_error(std::string("socket() failed: ") + strerror(errno));
+    fcntl(client.fd, F_SETFL, O_NONBLOCK);
+    int one = 1;
+    setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); //-> 遅延を測るので Nagle は切る
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_config.port);
+    inet_pton(AF_INET, _config.host.c_str(), &addr.sin_addr);
+    if (connect(client.fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 && errno != EINPROGRESS)
+        throw std::runtime_error(std::string("connect() failed: ") + strerror(errno));
+
+    if (static_cast<size_t>(client.fd) >= _by_fd.size())
+        _by_fd.resize(client.fd + 1, -1);
+    _by_fd[client.fd] = index;
+    _loop->add(client.fd, EVENT_READ | EVENT_WRITE); //-> 書き込み可能になったら接続完了
+}
+
+void Bench::finishConnect(BenchClient &client)
+{
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &len) == -1 || error != 0)
+    {
+        disconnect(client);
+        return;
+    }
+    client.state = BENCH_REGISTERING;
+    if (!_config.password.empty())
+        sendLine(client, "PASS " + _config.password);
+    sendLine(client, "NICK " + client.nick);
+    sendLine(client, "USER " + client.nick + " 0 * :ircbench");
+}
+
+void Bench::sendLine(BenchClient &client, const std::string &line)
+{
+    if (client.state == BENCH_DEAD)
+        return;
+    client.out += line;
+    client.out += "\r\n";
+    if (client.state != BENCH_CONNECTING)
+        flush(client);
+}
+
+void Bench::flush(BenchClient &client)
+{
+    while (!client.out.empty())
+    {
+        ssize_t n = ::send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            disconnect(client);
+            return;
+        }
+        client.out.erase(0, n);
+    }
+    bool want_write = !client.out.empty();
+    if (want_write != client.want_write)
+    {
+        _loop->modify(client.fd, want_write ? EVENT_READ | EVENT_WRITE : EVENT_READ);
+        client.want_write = want_write;
+    }
+}
+
+void Bench::readClient(BenchClient &client)
+{
+    while (client.state != BENCH_DEAD)
+    {
+        char *dst = client.in.prepare(LINEBUF_READ_CHUNK);
+        ssize_t n = recv(client.fd, dst, client.in.writable(), 0);
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n <= 0)
+        {
+            disconnect(client);
+            return;
+        }
+        client.in.commit(n);
+        StringView line;
+        while (client.state != BENCH_DEAD && client.in.nextLine(line))
+            handleLine(client, line);
+    }
+}
+
+// 受け取った 1 行を調べる。測定用のメッセージなら遅延を記録する
+void Bench::handleLine(BenchClient &client, const StringView &line)
+{
+    std::string text(line.data, line.size);
+    if (text.compare(0, 5, "PING ") == 0)
+    {
+        sendLine(client, "PONG " + text.substr(5));
+        return;
+    }
+    if (text.compare(0, 6, "ERROR ") == 0)
+    {
+        disconnect(client);
+        return;
+    }
+    size_t space = text.find(' ');
+    if (space == std::string::npos)
+        return;
+    std::string command = text.substr(space + 1, text.find(' ', space + 1) - space - 1);
+    if (command == "PRIVMSG")
+    {
+        size_t marker = text.find(BENCH_MARKER);
+        if (marker == std::string::npos)
+            return;
+        unsigned long sent_at = std::strtoul(text.c_str() + marker + strlen(BENCH_MARKER), NULL, 10);
+        unsigned long now = getMonotonicMicros();
+        if (_measuring && sent_at <= now)
+        {
+            _latency.record(now - sent_at);
+            _stats.delivered++;
+        }
+    }
+    else if (command == "001" && client.state == BENCH_REGISTERING)
+    {
+        client.state = BENCH_JOINING;
+        std::ostringstream join;
+        join << "JOIN #bench" << client.home;
+        sendLine(client, join.str());
+    }
+    else if (command == "JOIN" && client.state == BENCH_JOINING)
+    {
+        client.state = BENCH_RUNNING;
+        _running++;
+    }
+    else if (command.size() == 3 && (command[0] == '4' || command[0] == '5'))
+    {
+        if (_measuring)
+            _stats.errors++;
+        if (client.state != BENCH_RUNNING)
+        {
+            std::cerr << client.nick << ": " << text << std::endl;
+            disconnect(client); //-> 登録や JOIN に失敗した接続は使わない
+        }
+    }
+}
+
+void Bench::disconnect(BenchClient &client)
+{
+    if (client.state == BENCH_DEAD)
+        return;
+    if (client.state == BENCH_RUNNING)
+        _running--;
+    client.state = BENCH_DEAD;
+    _stats.dead++;
+    _loop->remove(client.fd);
+    close(client.fd);
+    _by_fd[client.fd] = -1;
+    client.fd = -1;
+}
+
+void Bench::pollOnce(int timeout_ms)
+{
+    int n = _loop->wait(_events, timeout_ms);
+    for (int i = 0; i < n; i++)
+    {
+        int fd = _events[i].fd;
+        if (fd < 0 || static_cast<size_t>(fd) >= _by_fd.size() || _by_fd[fd] == -1)
+            continue;
+        BenchClient &client = _clients[_by_fd[fd]];
+        if (client.state == BENCH_CONNECTING)
+        {
+            finishConnect(client);
+            continue;
+        }
+        if (_events[i].events & (EVENT_READ | EVENT_ERROR))
+            readClient(client);
+        if (client.state != BENCH_DEAD && (_events[i].events & EVENT_WRITE))
+            flush(client);
+    }
+}
+
+// 比率に従ってコマンドを 1 つ選んで送る
+void Bench::sendCommand(BenchClient &client)
+{
+    size_t total = _config.mix_privmsg + _config.mix_direct + _config.mix_join + _config.mix_mode;
+    size_t pick = std::rand() % total;
+    std::ostringstream line;
+    if (pick < _config.mix_privmsg)
+        line << "PRIVMSG #bench" << client.home << " " << BENCH_MARKER << getMonotonicMicros() << " " << _padding;
+    else if ((pick -= _config.mix_privmsg) < _config.mix_direct)
+    {
+        const BenchClient &peer = _clients[std::rand() % _clients.size()];
+        line << "PRIVMSG " << peer.nick << " " << BENCH_MARKER << getMonotonicMicros() << " " << _padding;
+    }
+    else if ((pick -= _config.mix_direct) < _config.mix_join)
+    {
+        // 別のチャンネルに出入りする（JOIN と PART で 2 行）
+        size_t other = std::rand() % _config.channels;
+        if (other == client.home)
+            other = (other + 1) % _config.channels;
+        line << "JOIN #bench" << other << "\r\nPART #bench" << other;
+    }
+    else
+        line << "MODE #bench" << client.home;
+    sendLine(client, line.str());
+    _stats.sent++;
+}
+
+size_t Bench::serverRss(const char *field) const
+{
+    if (_config.server_pid <= 0)
+        return 0;
+    std::ostringstream path;
+    path << "/proc/" << _config.server_pid << "/status";
+    std::ifstream status(path.str().c_str());
+    std::string line;
+    size_t field_len = strlen(field);
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, field_len, field) == 0)
+            return std::strtoul(line.c_str() + field_len, NULL, 10);
+    }
+    return 0;
+}
+
+int Bench::run()
+{
+    spawnServer();
+    waitForServer();
+
+    // 1. 接続して登録し、チャンネルに入る
+    unsigned long start = getMonotonicMicros();
+    size_t started = 0;
+    while (_running + _stats.dead < _clients.size())
+    {
+        for (size_t i = 0; i < CONNECT_BATCH && started < _clients.size(); i++)
+            connectClient(started++);
+        pollOnce(started < _clients.size() ? 0 : 10);
+        if (getMonotonicMicros() - start > SETUP_TIMEOUT)
+            break;
+    }
+    unsigned long setup_us = getMonotonicMicros() - start;
+    std::cout << "connected " << _running << "/" << _clients.size() << " clients in "
+              << setup_us / 1000 << " ms" << std::endl;
+    if (_running == 0)
+        throw std::runtime_error("no client completed registration");
+    size_t rss_idle = serverRss("VmRSS:");
+
+    // 2. 各接続が毎秒 rate 回ずつ、開始時刻をずらしてコマンドを送る
+    typedef std::pair<unsigned long, size_t> Due;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due> > schedule;
+    unsigned long interval = 1000000UL / _config.rate;
+    start = getMonotonicMicros();
+    for (size_t i = 0; i < _clients.size(); i++)
+        schedule.push(Due(start + std::rand() % interval, i));
+    unsigned long end = start + _config.duration * 1000000UL;
+    _measuring = true;
+    while (true)
+    {
+        unsigned long now = getMonotonicMicros();
+        if (now >= end)
+            break;
+        while (!schedule.empty() && schedule.top().first <= now)
+        {
+            Due due = schedule.top();
+            schedule.pop();
+            BenchClient &client = _clients[due.second];
+            if (client.state != BENCH_RUNNING)
+                continue;
+            sendCommand(client);
+            schedule.push(Due(due.first + interval, due.second));
+        }
+        unsigned long next = schedule.empty() ? end : std::min(end, schedule.top().first);
+        now = getMonotonicMicros();
+        pollOnce(next > now ? static_cast<int>((next - now) / 1000) : 0);
+    }
+    size_t rss_load = serverRss("VmRSS:");
+
+    // 3. 送信を止め、届き終わるまで受信だけ続ける
+    unsigned long drain_end = getMonotonicMicros() + DRAIN_TIME;
+    while (getMonotonicMicros() < drain_end)
+        pollOnce(10);
+    double seconds = (getMonotonicMicros() - start) / 1000000.0;
+    double send_seconds = _config.duration;
+
+    printf("clients      %lu (%lu channels, %lu cmd/s each, %lu s)\n", (unsigned long)_running,
+           (unsigned long)_config.channels, (unsigned long)_config.rate, (unsigned long)_config.duration);
+    printf("sent         %lu commands (%.0f/s)\n", _stats.sent, _stats.sent / send_seconds);
+    printf("delivered    %lu messages (%.0f/s)\n", _stats.delivered, _stats.delivered / seconds);
+    printf("latency      p50 %.3f ms  p99 %.3f ms  p999 %.3f ms  max %.3f ms\n",
+           _latency.percentile(0.50) / 1000.0, _latency.percentile(0.99) / 1000.0,
+           _latency.percentile(0.999) / 1000.0, _latency.max() / 1000.0);
+    printf("errors       %lu numeric errors, %lu disconnects\n", _stats.errors, _stats.dead);
+    if (_config.server_pid > 0)
+        printf("server RSS   %lu kB idle, %lu kB under load, %lu kB peak\n", (unsigned long)rss_idle,
+               (unsigned long)rss_load, (unsigned long)serverRss("VmHWM:"));
+    return (_stats.dead || _latency.count() == 0) ? FAILURE : 0;
+}
+
+static size_t parseCount(const std::string &option, const std::string &value, size_t min)
+{
+    char *end = NULL;
+    unsigned long n = std::strtoul(value.c_str(), &end, 10);
+    if (value.empty() || value[0] == '-' || *end != '\0' || n < min)
+        throw std::runtime_error("Invalid value for " + option + ": " + value);
+    return static_cast<size_t>(n);
+}
+
+// "privmsg=90,direct=4,join=3,mode=3" の形式
+static void parseMix(const std::string &value, BenchConfig &config)
+{
+    config.mix_privmsg = config.mix_direct = config.mix_join = config.mix_mode = 0;
+    std::vector<std::string> items = split(value, ',');
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        size_t eq = items[i].find('=');
+        std::string name = items[i].substr(0, eq);
+        size_t weight = eq == std::string::npos ? 1 : parseCount("--mix", items[i].substr(eq + 1), 0);
+        if (name == "privmsg")
+            config.mix_privmsg = weight;
+        else if (name == "direct")
+            config.mix_direct = weight;
+        else if (name == "join")
+            config.mix_join = weight;
+        else if (name == "mode")
+            config.mix_mode = weight;
+        else
+            throw std::runtime_error("Unknown command in --mix: " + name);
+    }
+    if (config.mix_privmsg + config.mix_direct + config.mix_join + config.mix_mode == 0)
+        throw std::runtime_error("--mix needs at least one command");
+}
+
+static void parseBenchOptions(int argc, char **argv, BenchConfig &config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--")
+        {
+            // 残りはサーバーを起動するコマンド
+            for (i++; i < argc; i++)
+                config.server_cmd.push_back(argv[i]);
+            break;
+        }
+        if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for option: " + option);
+        std::string value = argv[++i];
+
+        if (option == "--host")
+            config.host = value;
+        else if (option == "--port")
+            config.port = parseCount(option, value, 1);
+        else if (option == "--password")
+            config.password = value;
+        else if (option == "--clients")
+            config.clients = parseCount(option, value, 1);
+        else if (option == "--channels")
+            config.channels = parseCount(option, value, 1);
+        else if (option == "--duration")
+            config.duration = parseCount(option, value, 1);
+        else if (option == "--rate")
+            config.rate = parseCount(option, value, 1);
+        else if (option == "--size")
+            config.size = parseCount(option, value, 0);
+        else if (option == "--mix")
+            parseMix(value, config);
+        else if (option == "--server-pid")
+            config.server_pid = parseCount(option, value, 1);
+        else
+            throw std::runtime_error("Unknown option: " + option);
+    }
+    if (config.rate > 1000000)
+        throw std::runtime_error("Invalid value for --rate");
+}
+
+static void printBenchUsage()
+{
+    std::cout << "Usage: ./ircbench [options] [-- server command...]" << std::endl;
+    std::cout << "  --host ADDR        server address (default 127.0.0.1)" << std::endl;
+    std::cout << "  --port N           server port (default 6667)" << std::endl;
+    std::cout << "  --password PASS    connection password" << std::endl;
+    std::cout << "  --clients N        number of connections (default 1000)" << std::endl;
+    std::cout << "  --channels N       number of channels the clients are spread over (default 10)" << std::endl;
+    std::cout << "  --duration SEC     measurement time (default 10)" << std::endl;
+    std::cout << "  --rate N           commands per second per client (default 1)" << std::endl;
+    std::cout << "  --size BYTES       PRIVMSG line size (default 64)" << std::endl;
+    std::cout << "  --mix SPEC         command weights (default privmsg=90,direct=4,join=3,mode=3)" << std::endl;
+    std::cout << "  --server-pid PID   report the RSS of an already running server" << std::endl;
+    std::cout << "  -- CMD...          start the server with CMD and stop it afterwards" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    try
+    {
+        parseBenchOptions(argc, argv, config);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        printBenchUsage();
+        return FAILURE;
+    }
+
+    // 数千の接続を張るので fd の上限を引き上げる（起動するサーバーにも引き継がれる）
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0)
+    {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    std::srand(getpid());
+
+    try
+    {
+        Bench bench(config);
+        return bench.run();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "ircbench: " << e.what() << std::endl;
+        return FAILURE;
+    }
+}
@@ -0,0 +1,110 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   micro_dispatch.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 11:48:09 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 11:48:09 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// コマンド振り分けのマイクロベンチマーク
+// Server::executeCommand と同じ手順（表の検索、flood 制御のコスト計算、
+// ParsedMessage への変換）を行い、ハンドラの代わりに何もしない関数を呼ぶ。
+// ハンドラ本体は接続済みのクライアントが必要なので、ここでは測らず ircbench に任せる
+
+#include "microbench.hpp"
+#include "command.hpp"
+#include "numerical_replies.hpp"
+
+#include <stdexcept>
+
+// 解析済みの行（解析の時間は micro_parser で測るので含めない）
+struct DispatchArgs
+{
+    std::vector<MessageView> views;
+    std::vector<const CommandEntry *> entries; //-> views の各行を findCommand した結果（commandCost 用）
+};
+
+static size_t lookupAll(void *arg)
+{
+    const DispatchArgs &args = *static_cast<const DispatchArgs *>(arg);
+    size_t found = 0;
+    for (size_t i = 0; i < args.views.size(); i++)
+    {
+        if (findCommand(args.views[i].command))
+            found++;
+    }
+    g_micro_sink = g_micro_sink + found;
+    return args.views.size();
+}
+
+static size_t costAll(void *arg)
+{
+    const DispatchArgs &args = *static_cast<const DispatchArgs *>(arg);
+    size_t cost = 0;
+    for (size_t i = 0; i < args.views.size(); i++)
+        cost += commandCost(args.entries[i], args.views[i]);
+    g_micro_sink = g_micro_sink + cost;
+    return args.views.size();
+}
+
+//-> ハンドラの代わり。呼ばれたことだけ残す
+static void nullHandler(const ParsedMessage &msg)
+{
+    g_micro_sink = g_micro_sink + msg.params.size();
+}
+
+static size_t dispatchAll(void *arg)
+{
+    const DispatchArgs &args = *static_cast<const DispatchArgs *>(arg);
+    for (size_t i = 0; i < args.views.size(); i++)
+    {
+        const MessageView &view = args.views[i];
+        const CommandEntry *entry = findCommand(view.command);
+        if (entry)
+        {
+            ParsedMessage msg;
+            materializeMessage(view, msg);
+            msg.command = entry->name;
+            nullHandler(msg);
+        }
+        else
+        {
+            Reply reply = ERR_UNKNOWNCOMMAND("alice", viewToString(view.command));
+            g_micro_sink = g_micro_sink + reply.size();
+        }
+    }
+    return args.views.size();
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Corpus corpus;
+        loadCorpus(argc, argv, corpus);
+
+        DispatchArgs args;
+        MessageView view;
+        for (size_t i = 0; i < corpus.views.size(); i++)
+        {
+            if (parseMessage(corpus.views[i], view) && view.command.size > 0)
+            {
+                args.views.push_back(view);
+                args.entries.push_back(findCommand(view.command));
+            }
+        }
+        runMicro("dispatch/findCommand", lookupAll, &args);
+        runMicro("dispatch/commandCost", costAll, &args);
+        runMicro("dispatch/materialize+call", dispatchAll, &args);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
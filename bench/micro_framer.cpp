@@ -0,0 +1,78 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   micro_framer.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 11:26:52 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 11:26:52 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// LineBuffer（行フレーマ）のマイクロベンチマーク
+// コーパスの生データを recv と同じように TCP セグメント程度の大きさで流し込み、
+// nextLine() で行を切り出す。1 op は 1 行。
+// 受信バッファはサーバーと同じく RecvBufferPool から借り、空になったら返す
+
+#include "microbench.hpp"
+#include "line_buffer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#define FRAMER_SEGMENT 1460 //-> 1 回の recv で届く量（イーサネットの MSS 程度）
+
+struct FramerArgs
+{
+    const Corpus *corpus;
+    RecvBufferPool pool;
+    size_t segment;
+};
+
+static size_t frameAll(void *arg)
+{
+    FramerArgs &args = *static_cast<FramerArgs *>(arg);
+    const std::string &raw = args.corpus->raw;
+    LineBuffer buffer(&args.pool);
+    size_t lines = 0;
+    size_t bytes = 0;
+    StringView line;
+    for (size_t pos = 0; pos < raw.size(); pos += args.segment)
+    {
+        size_t n = std::min(args.segment, raw.size() - pos);
+        char *dst = buffer.prepare(n);
+        memcpy(dst, raw.data() + pos, n);
+        buffer.commit(n);
+        while (buffer.nextLine(line))
+        {
+            lines++;
+            bytes += line.size;
+        }
+        buffer.release();
+    }
+    g_micro_sink = g_micro_sink + bytes;
+    return lines;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Corpus corpus;
+        loadCorpus(argc, argv, corpus);
+
+        FramerArgs args;
+        args.corpus = &corpus;
+        args.segment = FRAMER_SEGMENT;
+        runMicro("framer/segment-1460", frameAll, &args);
+        args.segment = 1; //-> 1 バイトずつ届く最悪の場合
+        runMicro("framer/segment-1", frameAll, &args);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   micro_parser.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 11:03:18 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 11:03:18 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// parseMessage のマイクロベンチマーク
+// コーパスの各行を MessageView に分割する（行はメモリ上に読み込み済みで、フレーミングは含まない）
+
+#include "microbench.hpp"
+
+#include <stdexcept>
+
+static size_t parseAll(void *arg)
+{
+    const Corpus &corpus = *static_cast<const Corpus *>(arg);
+    size_t fields = 0;
+    MessageView msg;
+    for (size_t i = 0; i < corpus.views.size(); i++)
+    {
+        if (parseMessage(corpus.views[i], msg))
+            fields += msg.param_count + msg.has_trailing;
+    }
+    g_micro_sink = g_micro_sink + fields;
+    return corpus.views.size();
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Corpus corpus;
+        loadCorpus(argc, argv, corpus);
+        runMicro("parser/parseMessage", parseAll, &corpus);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
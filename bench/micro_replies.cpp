@@ -0,0 +1,107 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   micro_replies.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 12:21:47 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 12:21:47 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// 返信の整形のマイクロベンチマーク
+// numerical_replies.hpp のマクロで Reply を組み立てる。本文はコーパスの PRIVMSG から取る
+
+#include "microbench.hpp"
+#include "numerical_replies.hpp"
+
+#include <stdexcept>
+
+struct ReplyArgs
+{
+    std::vector<std::string> texts; //-> PRIVMSG の本文
+    std::string nick;
+    std::string username;
+    std::string channel;
+    std::string names; //-> RPL_NAMREPLY に渡すニックネーム一覧
+    ReplyTemplate welcome;
+};
+
+static size_t privmsgAll(void *arg)
+{
+    const ReplyArgs &args = *static_cast<const ReplyArgs *>(arg);
+    size_t bytes = 0;
+    for (size_t i = 0; i < args.texts.size(); i++)
+    {
+        Reply reply = RPL_PRIVMSG(args.nick, args.username, args.channel, args.texts[i]);
+        bytes += reply.size();
+    }
+    g_micro_sink = g_micro_sink + bytes;
+    return args.texts.size();
+}
+
+// 登録やチャンネル参加で送る短い定型の返信をまとめて 1 op とする
+static size_t numericsAll(void *arg)
+{
+    const ReplyArgs &args = *static_cast<const ReplyArgs *>(arg);
+    size_t bytes = 0;
+    for (size_t i = 0; i < args.texts.size(); i++)
+    {
+        bytes += RPL_JOIN(user_id(args.nick, args.username), args.channel.substr(1)).size();
+        bytes += RPL_NAMREPLY(args.nick, "=", args.channel.substr(1), args.names).size();
+        bytes += RPL_TOPIC(args.nick, args.channel.substr(1), args.texts[i]).size();
+        bytes += RPL_NICK(args.nick, args.username, "renamed").size();
+        bytes += ERR_NEEDMOREPARAMS(args.nick, "MODE").size();
+        bytes += ERR_NOSUCHNICK(args.nick, "nobody").size();
+    }
+    g_micro_sink = g_micro_sink + bytes;
+    return args.texts.size() * 6;
+}
+
+static size_t templateAll(void *arg)
+{
+    const ReplyArgs &args = *static_cast<const ReplyArgs *>(arg);
+    size_t bytes = 0;
+    for (size_t i = 0; i < args.texts.size(); i++)
+    {
+        Reply reply;
+        reply.format(args.welcome, args.nick);
+        bytes += reply.size();
+    }
+    g_micro_sink = g_micro_sink + bytes;
+    return args.texts.size();
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Corpus corpus;
+        loadCorpus(argc, argv, corpus);
+
+        ReplyArgs args;
+        args.nick = "alice";
+        args.username = "alice";
+        args.channel = "#linux";
+        args.names = "@alice bob carol dave eve mallory trent peggy victor walter";
+        args.welcome = ReplyTemplate(RPL_WELCOME(user_id(REPLY_NICK_MARKER, "alice"), REPLY_NICK_MARKER));
+        MessageView view;
+        for (size_t i = 0; i < corpus.views.size(); i++)
+        {
+            if (parseMessage(corpus.views[i], view) && view.has_trailing)
+                args.texts.push_back(viewToString(view.trailing));
+        }
+        if (args.texts.empty())
+            throw std::runtime_error("corpus has no lines with trailing text");
+        runMicro("replies/RPL_PRIVMSG", privmsgAll, &args);
+        runMicro("replies/numerics", numericsAll, &args);
+        runMicro("replies/template", templateAll, &args);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
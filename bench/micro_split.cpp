@@ -0,0 +1,60 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   micro_split.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 12:05:33 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 12:05:33 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// split() のマイクロベンチマーク
+// JOIN / PART / PRIVMSG などの最初の引数（カンマ区切りの宛先一覧）を分割する
+
+#include "microbench.hpp"
+
+#include <stdexcept>
+
+static size_t splitAll(void *arg)
+{
+    const std::vector<std::string> &lists = *static_cast<const std::vector<std::string> *>(arg);
+    size_t items = 0;
+    for (size_t i = 0; i < lists.size(); i++)
+        items += split(lists[i], ',').size();
+    g_micro_sink = g_micro_sink + items;
+    return lists.size();
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        Corpus corpus;
+        loadCorpus(argc, argv, corpus);
+
+        //-> 宛先一覧を取る（大文字小文字は区別しない。コマンドの表と同じ扱い）
+        std::vector<std::string> lists;
+        MessageView view;
+        for (size_t i = 0; i < corpus.views.size(); i++)
+        {
+            if (!parseMessage(corpus.views[i], view) || view.param_count == 0)
+                continue;
+            std::string command = viewToString(view.command);
+            for (size_t j = 0; j < command.size(); j++)
+                command[j] = toupper(command[j]);
+            if (command == "JOIN" || command == "PART" || command == "PRIVMSG" || command == "NOTICE")
+                lists.push_back(viewToString(view.params[0]));
+        }
+        if (lists.empty())
+            throw std::runtime_error("corpus has no JOIN/PART/PRIVMSG lines");
+        runMicro("split/targets", splitAll, &lists);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
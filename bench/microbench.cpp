@@ -0,0 +1,112 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   microbench.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 10:12:40 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 10:12:40 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "microbench.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+volatile size_t g_micro_sink = 0;
+
+static unsigned long g_alloc_count = 0;
+
+// 確保回数を数えるために置き換える（new[] も既定の実装がここを呼ぶ）
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+    ++g_alloc_count;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) throw()
+{
+    free(ptr);
+}
+
+unsigned long microAllocCount()
+{
+    return g_alloc_count;
+}
+
+void loadCorpus(int argc, char **argv, Corpus &corpus)
+{
+    const char *path = argc > 1 ? argv[1] : MICRO_DEFAULT_CORPUS;
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+        throw std::runtime_error(std::string("cannot open corpus: ") + path);
+    std::ostringstream content;
+    content << file.rdbuf();
+    corpus.raw = content.str();
+
+    size_t start = 0;
+    while (start < corpus.raw.size())
+    {
+        size_t end = corpus.raw.find('\n', start);
+        if (end == std::string::npos)
+            end = corpus.raw.size();
+        size_t len = end - start;
+        if (len > 0 && corpus.raw[start + len - 1] == '\r')
+            len--;
+        if (len > 0)
+            corpus.lines.push_back(corpus.raw.substr(start, len));
+        start = end + 1;
+    }
+    if (corpus.lines.empty())
+        throw std::runtime_error(std::string("empty corpus: ") + path);
+    //-> lines の再確保が終わってから指す先を取る
+    for (size_t i = 0; i < corpus.lines.size(); i++)
+    {
+        StringView view = {corpus.lines[i].data(), corpus.lines[i].size()};
+        corpus.views.push_back(view);
+    }
+    std::cout << "corpus: " << path << " (" << corpus.lines.size() << " lines, "
+              << corpus.raw.size() << " bytes)" << std::endl;
+}
+
+// 1 周を MICRO_MIN_TIME を超えるまで繰り返す試行を MICRO_TRIALS 回行い、中央値を取る。
+// 最初の 1 周は暖機（キャッシュやプールを温める）として数えない
+void runMicro(const char *name, MicroFunc func, void *arg)
+{
+    g_micro_sink = g_micro_sink + func(arg);
+
+    std::vector<double> ns_per_op;
+    double allocs_per_op = 0;
+    for (int trial = 0; trial < MICRO_TRIALS; trial++)
+    {
+        unsigned long allocs = g_alloc_count;
+        unsigned long start = getMonotonicMicros();
+        unsigned long elapsed = 0;
+        size_t ops = 0;
+        while (elapsed < MICRO_MIN_TIME)
+        {
+            ops += func(arg);
+            elapsed = getMonotonicMicros() - start;
+        }
+        if (ops == 0)
+            throw std::runtime_error(std::string(name) + ": no operations");
+        ns_per_op.push_back(elapsed * 1000.0 / ops);
+        allocs_per_op = static_cast<double>(g_alloc_count - allocs) / ops;
+    }
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+
+    char line[160];
+    snprintf(line, sizeof(line), "%-28s %10.1f ns/op %8.2f allocs/op", name,
+             ns_per_op[MICRO_TRIALS / 2], allocs_per_op);
+    std::cout << line << std::endl;
+}
@@ -0,0 +1,42 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   microbench.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 10:12:40 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 10:12:40 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+// マイクロベンチマークの共通部分（make microbench で各ベンチを実行する）
+// コーパスを 1 周する関数を何度も呼び、1 操作あたりの時間 (ns/op) と
+// ヒープ確保回数 (allocs/op) を表示する。確保回数はグローバルな operator new を
+// 置き換えて数えているので、std::string や std::vector の確保も含まれる。
+
+#include "irc.hpp"
+
+#define MICRO_DEFAULT_CORPUS "bench/corpus/client.txt" //-> 引数が無い時に読むコーパス
+#define MICRO_MIN_TIME 500000UL                        //-> 1 試行で最低限回す時間 (us)
+#define MICRO_TRIALS 5                                 //-> 試行回数（中央値を表示する）
+
+// コーパスを 1 周して、行った操作の数を返す
+typedef size_t (*MicroFunc)(void *arg);
+
+// 録音した IRC トラフィック（1 行 1 メッセージ）
+struct Corpus
+{
+    std::string raw;                    //-> ファイルの中身そのまま (\r\n 区切り)
+    std::vector<std::string> lines;     //-> 改行を除いた各行
+    std::vector<StringView> views;      //-> lines の各行を指す StringView
+};
+
+// argv[1] があればそれを、無ければ MICRO_DEFAULT_CORPUS を読む。読めなければ runtime_error
+void loadCorpus(int argc, char **argv, Corpus &corpus);
+void runMicro(const char *name, MicroFunc func, void *arg);
+unsigned long microAllocCount(); //-> プログラム開始からの operator new の呼び出し回数
+
+extern volatile size_t g_micro_sink; //-> 計算結果を書き込んで最適化で消されないようにする
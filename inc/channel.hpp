@@ -17,12 +17,26 @@
 #include <memory>
 
 #include "irc.hpp"
+#include "modes.hpp"
+#include "object_pool.hpp"
 // #include "client.hpp"
 // #include "server.hpp"
 
 class Server;
 class Client;
 
+#define MEMBER_OPERATOR 0x01 // チャンネルオペレーター (@)
+#define MEMBER_VOICE 0x02    // 発言権 (+)
+
+// チャンネルの参加者 1 人分
+// ニックネームではなく接続ごとに変わらない Client の id で識別するので、NICK で名前が変わっても壊れない
+struct ChannelMember
+{
+    unsigned long id;    // Client::getId()
+    Client *client;
+    unsigned char flags; // MEMBER_OPERATOR / MEMBER_VOICE
+};
+
 class Channel
 {
 private:
@@ -31,18 +45,23 @@ private:
     std::string _password; // +k モード用のキー
     int _userLimit;        // +l モードの制限人数（-1なら制限なし）
 
-    std::map<std::string, Client *> _clients; // ニックネーム → Client
-    std::set<std::string> _operators;         // オペレータ（ニックネーム）
+    std::vector<ChannelMember> _members; // 参加者（id の昇順に並べ、二分探索で引く）
+    size_t _operatorCount;               // MEMBER_OPERATOR を持つ参加者の数
     // std::set<std::string> _banList;           // BANされてるニックネーム
-    std::set<std::string> _inviteList; // 招待されたニックネーム（+i モード用）
+    std::set<unsigned long, std::less<unsigned long>, PoolAllocator<unsigned long> > _inviteList; // 招待されたクライアントの id（+i モード用）
 
-    std::set<char> _modes; // 有効なモード (+k, +l, +i, +b など)
-    bool _inviteOnly;      // +i モード（招待制）
+    ModeMask _modes;         // 有効なモード (CHANMODE_*)
+    std::string _modeString; // _modes を文字列にしたもの（RPL_CHANNELMODEIS 用にモード変更時だけ作り直す）
 
 public:
     Channel(const std::string &name);
     ~Channel() {}
 
+    // Channel 本体はスラブプールから確保する（new / delete の呼び出し側はそのまま）
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    static PoolStats poolStats();
+
     // 基本情報
     const std::string &getName() const;
     const std::string &getTopic() const;
@@ -53,10 +72,11 @@ public:
     void removeClient(Client &client);
     bool hasClient(const Client &client) const;
 
-    // オペレータ管理
-    void addOperator(const std::string &nickname);
-    void removeOperator(const std::string &nickname);
-    bool isOperator(const std::string &nickname) const;
+    // オペレータ管理（参加していないクライアントには何もしない）
+    void addOperator(const Client &client);
+    void removeOperator(const Client &client);
+    bool isOperator(const Client &client) const;
+    size_t getOperatorCount() const;
 
     // パスワード管理
     void setPassword(const std::string &password);
@@ -64,10 +84,11 @@ public:
     void removePassword(); // パスワードを削除
 
     // モード管理
-    void addMode(char mode);
-    void removeMode(char mode);
-    bool hasMode(char mode) const;
-    std::set<char> getModes() const;
+    void addMode(ModeMask mode);
+    void removeMode(ModeMask mode);
+    bool hasMode(ModeMask mode) const;
+    ModeMask getModes() const;
+    const std::string &getModeString() const;
 
     // BAN管理
     // void ban(const std::string &nickname);
@@ -75,10 +96,10 @@ public:
     // bool isBanned(const std::string &nickname) const;
 
     // 招待管理
-    void addInvite(const std::string &nickname);
-    void removeInvite(const std::string &nickname);
+    void addInvite(const Client &client);
+    void removeInvite(const Client &client);
     bool isInviteOnly() const;
-    bool isInvited(const std::string &nickname) const;
+    bool isInvited(const Client &client) const;
 
     // 容量制限
     void setUserLimit(int limit);
@@ -86,11 +107,14 @@ public:
 
     // メンバー一覧取得
     // std::map<int, Client *> getClients() const;
-    std::map<std::string, Client *> getClients() const;
-    // std::map<std::string, Client *> getOperators() const;
-    std::set<std::string> getOperators() const;
+    const std::vector<ChannelMember> &getMembers() const;
 
     // その他
     bool empty() const;
+    size_t size() const; // 参加人数
     void broadcast(Server *server, const std::string &message); // チャンネル内の全員にメッセージを送信
+
+private:
+    std::vector<ChannelMember>::iterator findMember(unsigned long id);
+    std::vector<ChannelMember>::const_iterator findMember(unsigned long id) const;
 };
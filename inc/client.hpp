@@ -14,6 +14,8 @@
 
 #include "irc.hpp"
 #include "color.hpp"
+#include "modes.hpp"
+#include "object_pool.hpp"
 // #include "channel.hpp"
 
 #include <iostream>
@@ -42,15 +44,22 @@ class Channel;
 
 class Client
 {
+public:
+    // 参加チャンネルの一覧。ノードは接続の出入りで頻繁に確保・解放されるのでプールから取る
+    typedef std::map<std::string, Channel *, std::less<std::string>,
+                     PoolAllocator<std::pair<const std::string, Channel *> > >
+        ChannelMap;
+
 private:
     int _fd;            // クライアントのファイルディスクリプタ
+    unsigned long _id;  // 接続ごとに一意な番号（fd と違って再利用されず、NICK でも変わらない）
     std::string _ipAdd; // IPアドレス
     std::string _nickname;
     std::string _username;
     std::string _realname; // 実名（REALNAMEはIRCでは一般的ではない）
-    std::set<char> _modes; // ユーザーモード（"i", "o"のみ）
+    ModeMask _modes;    // ユーザーモード（USERMODE_*、"i", "o"のみ）
     // std::string _hostname;
-    std::map<std::string, Channel *> _channels; // クライアントが参加しているチャンネルのマップ <channel_name, Channel*>
+    ChannelMap _channels; // クライアントが参加しているチャンネルのマップ <channel_name, Channel*>
 
     // 初期情報の登録フラグ
     bool _connexion_password; // パスワード接続フラグ
@@ -58,31 +67,39 @@ private:
     bool _hasUser;            // USERコマンドによるユーザー名登録フラグ
     bool _registrationDone;   // 登録完了フラグ
     bool _to_deconnect;       // 切断フラグ
+    bool _quit_sent;          // QUIT を送った（切断時にチャンネルへ PART を送らない）
     bool _pass_flag;          // パスワード接続フラグ（PASSコマンドによる）
+    unsigned long _flood_clock; // flood 制御: 使ったコマンド分だけ進む仮想時刻（マイクロ秒）
 
 public:
     Client();
     Client(int id, const std::string &ip);
     ~Client();
 
+    // Client 本体はスラブプールから確保する（new / delete の呼び出し側はそのまま）
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    static PoolStats poolStats();
+
     int getFd() const;
     void setFd(int newFd);
+    unsigned long getId() const;
 
-    std::string getIpAdd() const;
+    const std::string &getIpAdd() const;
     void setIpAdd(const std::string &ipadd);
 
-    std::string getNickname() const;
+    const std::string &getNickname() const;
     void setNickname(const std::string &nick);
-    std::string getUsername() const;
+    const std::string &getUsername() const;
     void setUsername(const std::string &user);
-    std::string getRealname() const;
+    const std::string &getRealname() const;
     void setRealname(const std::string &realname);
 
     // const std::string &hasModes() const;
-    const std::set<char> &getModes() const;
-    void addMode(char mode);
-    void removeMode(char mode);
-    bool hasMode(char mode) const;
+    ModeMask getModes() const;
+    void addMode(ModeMask mode);
+    void removeMode(ModeMask mode);
+    bool hasMode(ModeMask mode) const;
 
     // const std::string& getHostname() const ;
     // void setHostname(const std::string& host);
@@ -92,11 +109,13 @@ public:
     bool &hasUser();
     bool &isRegistrationDone();
     bool &getDeconnexionStatus();
+    bool &getQuitStatus();
     bool &getPassFlag(); // パスワード接続フラグ（PASSコマンドによる）
+    unsigned long &getFloodClock();
 
     // チャンネル関連
     bool isInChannel(Channel *channel) const;
-    const std::map<std::string, Channel *> &getChannels() const;
+    const ChannelMap &getChannels() const;
     void addChannel(Channel *channel);
     void removeChannel(Channel *channel);
 };
@@ -20,6 +20,28 @@
 
 class Server;
 
+typedef void (*CommandFunc)(Server *, int, ParsedMessage &);
+
+#define CMD_BEFORE_REGISTRATION 0x01 // 登録完了前に使えるコマンド
+#define CMD_AFTER_REGISTRATION 0x02  // 登録完了後に使えるコマンド
+
+// コマンド表の 1 エントリ
+struct CommandEntry
+{
+    const char *name; // 大文字のコマンド名
+    CommandFunc func; // 実行する関数
+    int flags;        // CMD_BEFORE_REGISTRATION / CMD_AFTER_REGISTRATION
+    int penalty;      // flood 制御で消費するトークン数
+};
+
+// コマンド名（大文字小文字は区別しない）から表のエントリを引く。無ければ NULL
+const CommandEntry *findCommand(const StringView &verb);
+CommandIndex findCommandIndex(const StringView &verb); //-> 同じく表の添字を引く。無ければ CMD_NONE
+const char *commandName(CommandIndex index);           //-> 表のコマンド名（CMD_NONE は "unknown"）
+CommandIndex commandIndex(const CommandEntry *entry);  //-> findCommand の結果を添字に戻す（NULL は CMD_NONE）
+// 1 行で消費するトークン数（entry は findCommand の結果。チャンネル宛ての PRIVMSG は宛先ごとに加算）
+unsigned int commandCost(const CommandEntry *entry, const MessageView &msg);
+
 void pass(Server *server, int client_fd, ParsedMessage &msg);
 void nick(Server *server, int client_fd, ParsedMessage &msg);
 void user(Server *server, int client_fd, ParsedMessage &msg);
@@ -0,0 +1,63 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   config.hpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/06 14:40:02 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/06 14:40:02 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#include "logger.hpp"
+
+// 起動オプションで変更できるサーバー設定
+// ./ircserv <port> <password> [--option value ...]
+struct ServerConfig
+{
+    std::string backend; //-> イベントループ実装 ("epoll" / "poll"、空なら既定値)
+
+    // 送信キューの上限 (0 は無制限)
+    // soft を超えたメッセージは破棄、hard を超えたら "Max SendQ exceeded" で切断する
+    size_t sendq_soft_bytes;
+    size_t sendq_hard_bytes;
+    size_t sendq_soft_msgs;
+    size_t sendq_hard_msgs;
+
+    size_t threads; //-> ソケット入出力のスレッド数 (epoll のみ。poll では常に 1。コマンドは 1 つずつ処理)
+
+    // 1 秒あたりに受け付ける新規接続数 (0 は無制限)。超えた接続は ERROR を送ってすぐ閉じる
+    size_t accept_rate;    //-> サーバー全体
+    size_t accept_ip_rate; //-> 接続元 IP ごと
+
+    // コマンドの flood 制御（トークンバケット）
+    // 1 秒に flood_rate コマンドまで、最大 flood_burst コマンド分まで先行できる。
+    // 使い切ったクライアントは入力の処理を止める (fake lag)。flood_rate が 0 なら無効
+    size_t flood_rate;
+    size_t flood_burst;
+
+    size_t line_quota; //-> 1 回のループで 1 クライアントから処理する最大行数 (0 は無制限)
+
+    // 計測値 (/metrics) の待ち受け先。どちらか一方だけ指定でき、どちらも無ければ待ち受けない
+    size_t metrics_port;        //-> 127.0.0.1 の TCP ポート (0 は無効)
+    std::string metrics_socket; //-> UNIX ドメインソケットのパス
+
+    // 1 周の処理時間（wait を除く）がこれを超えたら内訳をログに出す (ms、0 は無効)
+    size_t stall_budget_ms;
+    std::string trace_file; //-> Chrome のトレース (JSON) を書き出すファイル（空なら書かない）
+
+    LogLevel log_level; //-> これより低いレベルのログは出さない (debug は DEBUG_LOG=1 でビルドした時だけ)
+
+    ServerConfig();
+};
+
+// argv[first] 以降のオプションを config に読み込む。不正な指定は例外を投げる
+void parseServerOptions(int argc, char **argv, int first, ServerConfig &config);
+// 使い方と指定できるオプションの一覧を表示する
+void printServerUsage();
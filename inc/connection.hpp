@@ -0,0 +1,65 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   connection.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/13 11:32:08 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/13 11:32:08 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "irc.hpp"
+#include "send_queue.hpp"
+#include "line_buffer.hpp"
+
+#define CONNTABLE_CHUNK 256       //-> 1 チャンクあたりのスロット数
+#define CONNTABLE_MAX_FDS 1048576 //-> RLIMIT_NOFILE が無制限の場合に扱う fd の上限
+
+class Client;
+struct Worker;
+
+// 接続 1 本分の状態。fd をそのまま添字にして ConnectionTable に並べる
+// よく触るものを 1 か所に集め、fd ごとの map を何本も引かずに済むようにする
+struct Connection
+{
+    int fd;
+    Client *client;             //-> NULL なら空きスロット（_registry_lock で保護）
+    Worker *owner;              //-> 担当スレッド（_registry_lock の下で acquire / release で読み書きする）
+    SendQueue send_queue;       //-> 送信キュー（自身のロックで保護）
+    LineBuffer recv_buffer;     //-> 受信バッファ（担当スレッドだけが触る）
+    unsigned long paused_until; //-> flood 制御で入力を止めている間の再開時刻、止めていなければ 0（担当スレッドだけ）
+    bool ready;                 //-> Worker::ready に入っている（担当スレッドだけ）
+
+    Connection();
+};
+
+// fd → Connection の表
+// カーネルは小さい番号から fd を割り当てるので、木を引く代わりに添字 1 回で引ける。
+// スロットは CONNTABLE_CHUNK 個ずつまとめて確保し、一度確保したチャンクは動かさない。
+// そのため他のスレッドが持っている Connection へのポインタは、その接続が続く間ずっと有効
+class ConnectionTable
+{
+private:
+    Connection **_chunks; //-> チャンクの一覧（大きさは init で固定し、再確保しない）
+    size_t _chunk_count;
+    size_t _limit;        //-> 確保済みスロットの終端（走査用。書くのは open() だけで、読むのはどのスレッドからでもよい）
+
+    ConnectionTable(const ConnectionTable &other);
+    ConnectionTable &operator=(const ConnectionTable &other);
+
+public:
+    ConnectionTable();
+    ~ConnectionTable();
+
+    void init(size_t max_fds); //-> 扱う fd の上限を決める（スレッドを起動する前に呼ぶ）
+    size_t limit() const;      //-> 0 〜 limit() - 1 を走査すれば全スロットを見られる
+
+    // fd のスロットを返す。範囲外かチャンクが未確保なら NULL（どのスレッドから呼んでもよい）
+    Connection *find(int fd) const;
+    // fd のスロットを返す。チャンクが無ければ確保する。範囲外なら NULL（_registry_lock を保持して呼ぶ）
+    Connection *open(int fd);
+};
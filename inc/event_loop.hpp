@@ -0,0 +1,95 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   event_loop.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/06 14:12:31 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/06 14:12:31 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "irc.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h> //-> for epoll_create1()
+#endif
+
+// イベントループに登録・通知するイベントの種類
+#define EVENT_READ 0x01  //-> 読み込み可能
+#define EVENT_WRITE 0x02 //-> 書き込み可能
+#define EVENT_ERROR 0x04 //-> エラー / 切断 (通知のみ)
+#define EVENT_EDGE 0x08  //-> エッジトリガで監視する (epoll のみ有効)
+
+// wait() が返す 1 件分のイベント
+struct IoEvent
+{
+    int fd;     //-> 対象のファイルディスクリプタ
+    int events; //-> EVENT_READ / EVENT_WRITE / EVENT_ERROR の組み合わせ
+};
+
+// イベントループのバックエンド共通インターフェース
+// Server はこのインターフェースだけを使い、poll / epoll の違いを意識しない
+class EventLoop
+{
+public:
+    virtual ~EventLoop() {}
+
+    virtual void add(int fd, int events) = 0;    //-> fd を監視対象に追加
+    virtual bool modify(int fd, int events) = 0; //-> 監視するイベントを変更（登録されていない fd なら false）
+    virtual void remove(int fd) = 0;             //-> fd を監視対象から外す
+    // イベントを待ち、発生したものだけを ready に詰めて件数を返す (-1 はエラー)
+    virtual int wait(std::vector<IoEvent> &ready, int timeout_ms) = 0;
+    virtual const char *name() const = 0;
+
+    // backend が空ならプラットフォームの既定値 (Linux では epoll) を使う
+    static EventLoop *create(const std::string &backend);
+};
+
+// poll() によるフォールバック実装（レベルトリガ）
+class PollLoop : public EventLoop
+{
+private:
+    std::vector<struct pollfd> _fds; //-> vector of pollfd
+    std::vector<int> _slots;         //-> fd → _fds の添字 (-1 は未登録)
+
+    int findSlot(int fd) const;
+
+public:
+    PollLoop();
+    ~PollLoop();
+
+    void add(int fd, int events);
+    bool modify(int fd, int events);
+    void remove(int fd);
+    int wait(std::vector<IoEvent> &ready, int timeout_ms);
+    const char *name() const;
+};
+
+#ifdef __linux__
+// epoll によるエッジトリガ実装
+// 1 回の wait のコストは接続数ではなくアクティブなソケット数に比例する
+// add / modify / remove は wait 中の別スレッドから呼んでもよい（epoll_ctl はスレッドセーフ）
+class EpollLoop : public EventLoop
+{
+private:
+    int _epfd;                               //-> epoll インスタンス
+    std::vector<struct epoll_event> _events; //-> epoll_wait の受け取り領域
+    size_t _registered;                      //-> 登録中の fd 数（他のスレッドからも add される）
+
+    bool control(int op, int fd, int events); //-> fd が閉じられた・未登録 (EBADF / ENOENT) なら false
+
+public:
+    EpollLoop();
+    ~EpollLoop();
+
+    void add(int fd, int events);
+    bool modify(int fd, int events);
+    void remove(int fd);
+    int wait(std::vector<IoEvent> &ready, int timeout_ms);
+    const char *name() const;
+};
+#endif
@@ -40,6 +40,13 @@
 #define REQUIRED_INFO_COUNT 2 // NICK, USERコマンドによる情報登録は必要
 // #define PORT 6667 // IRCの標準ポート
 
+// 受信バッファ内の 1 行など、所有しない文字列の範囲
+struct StringView
+{
+    const char *data;
+    size_t size;
+};
+
 struct ParsedMessage
 {
     std::string prefix;              // 送信者情報（例: :nick!user@host）
@@ -48,6 +55,47 @@ struct ParsedMessage
     std::string trailing;            // コマンドの後ろに続くメッセージ
 };
 
+#define MAX_PARAMS 15 // RFC 1459: 1 メッセージの引数はトレーリングも含めて最大 15 個
+
+// 1 行をその場で分割した結果。各要素は元の行を指すだけでコピーしない
+// 例: @time=... :dan!d@localhost PRIVMSG #chan :Hello
+struct MessageView
+{
+    StringView tags;                   // IRCv3 メッセージタグ（先頭の @ は含まない）
+    StringView prefix;                 // 送信者情報（先頭の : は含まない）
+    StringView command;                // IRCコマンド名
+    StringView params[MAX_PARAMS - 1]; // コマンドの引数（15 個目はトレーリングに入る）
+    size_t param_count;                // 引数の数
+    StringView trailing;               // " :" 以降、または 15 個目の引数から行末まで
+    bool has_trailing;                 // トレーリングがあるか（空文字列も含む）
+};
+
 std::vector<std::string> split(const std::string &str, char delimiter);
+unsigned long getMonotonicMicros(); //-> 時刻合わせの影響を受けない経過時間（マイクロ秒）
+unsigned long getMonotonicNanos();  //-> 同じくナノ秒（処理時間の計測用）
+
+// コマンド表の添字（parsing.cpp の g_commands と同じ並び）。CMD_NONE は未知のコマンド
+enum CommandIndex
+{
+    CMD_CAP,
+    CMD_INVITE,
+    CMD_JOIN,
+    CMD_KICK,
+    CMD_MODE,
+    CMD_NICK,
+    CMD_PART,
+    CMD_PASS,
+    CMD_PING,
+    CMD_PRIVMSG,
+    CMD_QUIT,
+    CMD_TOPIC,
+    CMD_USER,
+    CMD_NONE
+};
+
+bool parseMessage(const StringView &line, MessageView &msg);        // 1 行を MessageView に分割
+void materializeMessage(const MessageView &view, ParsedMessage &msg); // 文字列を持つ ParsedMessage を作る
+bool viewEquals(const StringView &view, const char *str);          // StringView と文字列の比較
+std::string viewToString(const StringView &view);
 
 #endif // IRC_HPP
@@ -0,0 +1,86 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   line_buffer.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/08 10:21:05 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/08 10:21:05 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "irc.hpp"
+
+#define LINEBUF_READ_CHUNK 4096 //-> 1 回の recv で確保する最低限の空き
+#define LINEBUF_MAX_LINE 8704   //-> 1 行の最大長 (IRCv3 タグ 8191 + 本体 512 程度)
+#define RECVPOOL_CLASSES 3      //-> サイズクラスの数 (4K, 8K, 16K)
+#define RECVPOOL_KEEP 64        //-> サイズクラスごとに手元に残しておく空きバッファの上限
+
+// 受信バッファのプール（イベントループごとに 1 つ。担当スレッドだけが触るのでロックは無い。統計値は他のスレッドからも読める）
+// 大きさは LINEBUF_READ_CHUNK の 2 のべき乗倍に丸め、返却されたバッファは同じクラスで使い回す。
+// 溜め込みすぎないよう、空きが RECVPOOL_KEEP を超えた分はヒープに返す
+class RecvBufferPool
+{
+private:
+    std::vector<char *> _free[RECVPOOL_CLASSES];
+    size_t _in_use;       //-> 貸し出し中のバッファ数（/metrics から読むので __atomic で読み書き）
+    size_t _cached_bytes; //-> 空きリストに残っているバイト数（同上）
+
+    RecvBufferPool(const RecvBufferPool &other);
+    RecvBufferPool &operator=(const RecvBufferPool &other);
+
+public:
+    RecvBufferPool();
+    ~RecvBufferPool();
+
+    // min_size バイト以上のバッファを借りる。capacity には実際の大きさが入る
+    char *acquire(size_t min_size, size_t &capacity);
+    void release(char *buf, size_t capacity);
+
+    size_t inUse() const;
+    size_t cachedBytes() const;
+};
+
+// クライアントごとの受信バッファ（行フレーマ）
+// [_start, _end) が未処理のデータで、_scan までは改行が無いことを確認済み。
+// 改行は memchr で一度だけ探し、行は StringView としてバッファ内を指したまま渡す。
+// 前詰め (compact) は空きが足りなくなった時にだけ行う。
+// 記憶領域は RecvBufferPool から借り、未処理のデータが無くなったら release() で返す。
+// 何も受信していない接続は受信用のメモリを持たない
+class LineBuffer
+{
+private:
+    RecvBufferPool *_pool; //-> NULL ならヒープから直接確保する
+    char *_buf;
+    size_t _capacity;
+    size_t _start;    //-> 未処理データの先頭
+    size_t _end;      //-> 未処理データの終端
+    size_t _scan;     //-> 改行探索を再開する位置
+    bool _discarding; //-> 長すぎる行を次の改行まで読み捨て中
+
+    char *allocate(size_t min_size, size_t &capacity);
+    void deallocate(char *buf, size_t capacity);
+
+public:
+    LineBuffer(RecvBufferPool *pool = NULL);
+    void setPool(RecvBufferPool *pool); //-> 借りる先のプールを変える（持っているデータは捨てる）
+    LineBuffer(const LineBuffer &other);
+    LineBuffer &operator=(const LineBuffer &other);
+    ~LineBuffer();
+
+    // recv 先として min_space バイト以上の空きを確保し、書き込み位置を返す
+    char *prepare(size_t min_space);
+    size_t writable() const; //-> prepare() 後に書き込めるバイト数
+    void commit(size_t n);   //-> recv で書き込んだバイト数を反映する
+
+    // 次の 1 行を取り出す（末尾の \r\n / \n は含まない）
+    // line は次に prepare() を呼ぶまで有効
+    bool nextLine(StringView &line);
+
+    size_t size() const; //-> 未処理のバイト数
+    void release();      //-> 未処理のデータが無ければ記憶領域をプールに返す
+    void clear();
+};
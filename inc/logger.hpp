@@ -0,0 +1,121 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   logger.hpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/16 10:24:37 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/16 10:24:37 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "irc.hpp"
+
+#include <pthread.h>
+
+#define LOG_RING_SIZE 4096       //-> リングバッファの行数（2 のべき乗）
+#define LOG_LINE_MAX 256         //-> 1 行の最大長。超えた分は切り捨てる
+#define LOG_FLUSH_INTERVAL 10000 //-> 書き出しスレッドがリングバッファを見に行く間隔 (us)
+#define LOG_BATCH_BYTES 65536    //-> 1 回の write にまとめる最大バイト数
+
+enum LogLevel
+{
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+};
+
+// 非同期のログ出力
+// イベントループのスレッドは整形した 1 行をリングバッファに積むだけで、write は書き出し用の
+// スレッドが LOG_FLUSH_INTERVAL ごとにまとめて行う。リングバッファは複数スレッドが書き込める
+// ロックフリーのキュー（各スロットの通し番号で空き・使用中を判定する）で、一杯なら待たずに
+// その行を捨てて数だけ数える。start() の前と stop() の後はその場で write する
+class Logger
+{
+private:
+    struct Slot
+    {
+        size_t seq;           //-> 書き込み側と読み出し側の受け渡しに使う通し番号
+        unsigned long time;   //-> 積んだ時刻（エポックからの us）
+        LogLevel level;
+        size_t size;
+        char text[LOG_LINE_MAX];
+    };
+
+    static Slot *_ring;
+    static size_t _head;     //-> 次に書き込む位置（書き込み側が CAS で進める）
+    static size_t _tail;     //-> 次に読み出す位置（書き出しスレッドだけが触る）
+    static int _level;       //-> これより低いレベルは捨てる
+    static bool _running;
+    static pthread_t _thread;
+    static size_t _dropped;  //-> リングバッファが一杯で捨てた行数
+
+    static void *writerMain(void *arg);
+    static void drain(std::string &batch);
+    static void format(std::string &out, unsigned long time, LogLevel level, const char *text, size_t size);
+    static void flush(std::string &batch);
+
+public:
+    static void start(LogLevel level); //-> 書き出しスレッドを起動する
+    static void stop();                //-> 残りを書き出してスレッドを止める
+    static void setLevel(LogLevel level);
+    static bool enabled(LogLevel level) { return level >= __atomic_load_n(&_level, __ATOMIC_RELAXED); }
+    static void write(LogLevel level, const char *text, size_t size);
+    static bool parseLevel(const std::string &name, LogLevel &level); //-> "debug" などを読む
+};
+
+// ログ 1 行を組み立てるバッファ（スタック上の固定長で、ヒープは使わない）
+// 破棄される時に Logger::write() に渡す
+class LogLine
+{
+private:
+    LogLevel _level;
+    char _buf[LOG_LINE_MAX];
+    size_t _size;
+
+    LogLine(const LogLine &other);
+    LogLine &operator=(const LogLine &other);
+
+public:
+    explicit LogLine(LogLevel level) : _level(level), _size(0) {}
+    ~LogLine() { Logger::write(_level, _buf, _size); }
+
+    LogLine &append(const char *data, size_t size);
+    LogLine &operator<<(const char *str) { return append(str, strlen(str)); }
+    LogLine &operator<<(const std::string &str) { return append(str.data(), str.size()); }
+    LogLine &operator<<(const StringView &view) { return append(view.data, view.size); }
+    LogLine &operator<<(char c) { return append(&c, 1); }
+    LogLine &operator<<(long n);
+    LogLine &operator<<(unsigned long n);
+    LogLine &operator<<(int n) { return *this << static_cast<long>(n); }
+    LogLine &operator<<(unsigned int n) { return *this << static_cast<unsigned long>(n); }
+};
+
+// 使い方: LOG_INFO("Client <" << fd << "> Connected");
+// レベルが無効なら引数の式は評価されない
+#define LOG_AT(level, message)                \
+    do                                        \
+    {                                         \
+        if (Logger::enabled(level))           \
+        {                                     \
+            LogLine log_line_(level);         \
+            log_line_ << message;             \
+        }                                     \
+    } while (0)
+
+// デバッグログは make DEBUG_LOG=1 でビルドした時だけ残す（通常のビルドではコードごと消える）
+#ifdef LOG_ENABLE_DEBUG
+#define LOG_DEBUG(message) LOG_AT(LOG_LEVEL_DEBUG, message)
+#else
+#define LOG_DEBUG(message) \
+    do                     \
+    {                      \
+    } while (0)
+#endif
+#define LOG_INFO(message) LOG_AT(LOG_LEVEL_INFO, message)
+#define LOG_WARN(message) LOG_AT(LOG_LEVEL_WARN, message)
+#define LOG_ERROR(message) LOG_AT(LOG_LEVEL_ERROR, message)
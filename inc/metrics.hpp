@@ -0,0 +1,129 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   metrics.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 15:32:06 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 15:32:06 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "irc.hpp"
+#include "event_loop.hpp"
+
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BITS 4                          //-> 2 のべき乗の区間を 16 分割する（誤差 6% 程度）
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_BITS 40                         //-> これ以上の値は最後の区間に入れる (ns なら約 18 分)
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+#define METRICS_MAX_CLIENTS 8                         //-> 同時に受け付ける /metrics の接続数
+#define METRICS_MAX_REQUEST 4096                      //-> HTTP リクエストの最大長
+
+// 値の分布を数えるヒストグラム（HDR 方式）
+// 2 のべき乗ごとの区間をさらに HISTOGRAM_SUB_COUNT 等分して数えるので、
+// 大きさの桁に関係なく相対誤差が一定のまま、全サンプルを持たずに分布を残せる。
+// record() は持ち主のスレッドだけが呼び、他のスレッドは load() で読むだけ。
+// 読み書きは relaxed のアトミック操作なので、ロックも lock 付きの命令も使わない
+class Histogram
+{
+private:
+    uint64_t _counts[HISTOGRAM_BUCKETS];
+    uint64_t _count;
+    uint64_t _sum;
+
+    static size_t bucketOf(uint64_t value);
+
+public:
+    Histogram();
+
+    void record(uint64_t value);           //-> 持ち主のスレッドから
+    void load(Histogram &total) const;     //-> total に加算する（どのスレッドからでもよい）
+    uint64_t count() const { return _count; }
+    uint64_t sum() const { return _sum; }
+    uint64_t countAtMost(uint64_t value) const; //-> value 以下の区間に入ったサンプル数 (Prometheus の le)
+};
+
+// スレッドごとの計測値
+// 書き込むのは担当スレッドだけなので、他のスレッドとキャッシュラインを取り合わない。
+// /metrics の要求が来た時に全スレッド分を足し合わせる
+struct WorkerMetrics
+{
+    Histogram command_time[CMD_NONE + 1]; //-> コマンドごとの処理時間 (ns)。CMD_NONE は未知のコマンド
+    Histogram loop_time;                  //-> イベントループ 1 周の処理時間 (ns、wait の待ち時間は含まない)
+    Histogram sendq_depth;                //-> 書き込み可能になった時点の送信キューの大きさ (バイト)
+    uint64_t bytes_in;                    //-> recv したバイト数
+    uint64_t bytes_out;                   //-> 送信したバイト数
+
+    WorkerMetrics() : bytes_in(0), bytes_out(0) {}
+};
+
+// 担当スレッドだけが書き込むカウンタに加算する（読み手とは relaxed で競合しない）
+inline void metricsAdd(uint64_t &counter, uint64_t value)
+{
+    __atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+// Prometheus のテキスト形式 (version 0.0.4) を組み立てる
+class MetricsWriter
+{
+private:
+    std::ostringstream _out;
+
+public:
+    MetricsWriter();
+
+    void header(const char *name, const char *type, const char *help);
+    void value(const char *name, const std::string &labels, double value);
+    // カウンタや個数は double を通さずに整数のまま書く（大きくなっても指数表記にならない）
+    void value(const char *name, const std::string &labels, uint64_t value);
+    // bounds の各値を le とする累積の区間を書く。scale は出力する単位への換算 (ns → 秒なら 1e-9)
+    void histogram(const char *name, const std::string &labels, const Histogram &histogram,
+                   const uint64_t *bounds, size_t bound_count, double scale);
+    std::string str() const { return _out.str(); }
+};
+
+// /metrics を返すだけの小さな HTTP サーバー
+// 127.0.0.1 の TCP ポートか UNIX ドメインソケットで待ち受け、外部には公開しない。
+// worker 0 のイベントループに相乗りし、レベルトリガで監視する
+class MetricsEndpoint
+{
+private:
+    struct Request
+    {
+        std::string data;   //-> 受信したリクエスト
+        std::string output; //-> 送信するレスポンス
+        size_t sent;
+
+        Request() : sent(0) {}
+    };
+
+    int _listen_fd;
+    std::string _unix_path; //-> UNIX ドメインソケットのパス（終了時に削除する）
+    EventLoop *_loop;
+    std::map<int, Request> _requests;
+
+    MetricsEndpoint(const MetricsEndpoint &other);
+    MetricsEndpoint &operator=(const MetricsEndpoint &other);
+
+    void closeRequest(int fd);
+    void flush(int fd, Request &request);
+
+public:
+    MetricsEndpoint();
+    ~MetricsEndpoint();
+
+    // port が 0 でなければ 127.0.0.1:port、unix_path が空でなければそのパスで待ち受ける（両方指定は不可）
+    void open(EventLoop *loop, int port, const std::string &unix_path);
+    void close();
+    bool enabled() const { return _listen_fd != -1; }
+    // fd がこのエンドポイントのものか（接続が無い時は待ち受けソケットとの比較だけで済む）
+    bool owns(int fd) const { return fd == _listen_fd || (!_requests.empty() && _requests.count(fd)); }
+    // イベントを処理する。fd のリクエストを受け取り終えたら true を返し、path に要求されたパスを入れる
+    bool handle(int fd, int events, std::string &path);
+    void respond(int fd, int status, const std::string &body); //-> レスポンスを送り始める
+};
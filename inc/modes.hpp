@@ -0,0 +1,48 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   modes.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/12 10:20:41 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/12 10:20:41 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+// モードは英字 1 文字につき 64bit マスクの 1 bit を割り当てる（a-z → 0-25, A-Z → 26-51）
+// 判定は AND 1 回で済み、set<char> のようなヒープ確保もない
+typedef uint64_t ModeMask;
+
+#define MODE_BIT(c) ((c) >= 'a' && (c) <= 'z'   ? (ModeMask)1 << ((c) - 'a')      \
+                     : (c) >= 'A' && (c) <= 'Z' ? (ModeMask)1 << ((c) - 'A' + 26) \
+                                                : (ModeMask)0)
+
+// チャンネルモード
+#define CHANMODE_INVITE MODE_BIT('i') // +i 招待制
+#define CHANMODE_KEY MODE_BIT('k')    // +k パスワード
+#define CHANMODE_LIMIT MODE_BIT('l')  // +l 人数制限
+#define CHANMODE_TOPIC MODE_BIT('t')  // +t トピック変更はオペレーターのみ
+
+// ユーザーモード
+#define USERMODE_INVISIBLE MODE_BIT('i')
+#define USERMODE_OPERATOR MODE_BIT('o')
+
+// モード表の 1 エントリ（文字 ↔ bit ↔ 引数の要否）
+struct ModeInfo
+{
+    char letter;
+    ModeMask bit;        // チャンネル/ユーザー自体に付くモードの bit（+o のようなメンバー単位のモードは 0）
+    bool param_on_set;   // +x のとき引数を取る
+    bool param_on_unset; // -x のとき引数を取る
+};
+
+// サポートしているチャンネルモードを引く。無ければ NULL
+const ModeInfo *findChannelMode(char letter);
+// マスクを "+iklt" 形式の文字列にする（何も無ければ空文字列）
+std::string modeMaskToString(ModeMask mask);
@@ -0,0 +1,46 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   mutex.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/10 14:12:40 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/10 14:12:40 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <pthread.h>
+
+// pthread_mutex の薄いラッパー（C++98 には std::mutex が無いため）
+class Mutex
+{
+private:
+    pthread_mutex_t _mutex;
+
+    Mutex(const Mutex &other);
+    Mutex &operator=(const Mutex &other);
+
+public:
+    Mutex() { pthread_mutex_init(&_mutex, NULL); }
+    ~Mutex() { pthread_mutex_destroy(&_mutex); }
+
+    void lock() { pthread_mutex_lock(&_mutex); }
+    void unlock() { pthread_mutex_unlock(&_mutex); }
+};
+
+// スコープを抜けると自動で unlock する
+class ScopedLock
+{
+private:
+    Mutex &_mutex;
+
+    ScopedLock(const ScopedLock &other);
+    ScopedLock &operator=(const ScopedLock &other);
+
+public:
+    explicit ScopedLock(Mutex &mutex) : _mutex(mutex) { _mutex.lock(); }
+    ~ScopedLock() { _mutex.unlock(); }
+};
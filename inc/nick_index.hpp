@@ -0,0 +1,57 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   nick_index.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/09 11:02:14 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/09 11:02:14 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Client;
+
+// rfc1459 casemapping: A-Z と []\^ をそれぞれ a-z と {}|~ に揃える
+inline char ircToLower(char c)
+{
+    if (c >= 'A' && c <= '^')
+        return c + ('a' - 'A');
+    return c;
+}
+
+bool ircCaseEquals(const std::string &a, const std::string &b); //-> casemapping を考慮して比較
+
+// ニックネーム → Client* のハッシュ索引
+// キーは casemapping で小文字化して保持し、オープンアドレス法（線形探索）で引く。
+// 削除は後ろの要素を詰め直すので墓標は残らない。検索時にメモリ確保はしない。
+class NickIndex
+{
+private:
+    struct Slot
+    {
+        std::string key; //-> 小文字化したニックネーム
+        Client *client;  //-> NULL なら空き
+    };
+
+    std::vector<Slot> _slots; //-> 要素数は常に 2 のべき乗
+    size_t _size;
+
+    static size_t hash(const std::string &nick);
+    size_t findSlot(const std::string &nick) const; //-> 見つからなければ空きスロット
+    void rehash(size_t capacity);
+
+public:
+    NickIndex();
+
+    Client *find(const std::string &nick) const;
+    bool insert(const std::string &nick, Client *client); //-> 既に使われていれば false
+    void erase(const std::string &nick, Client *client);  //-> client の登録なら削除
+    size_t size() const;
+    void clear();
+};
@@ -1,6 +1,8 @@
 #ifndef NUMERICAL_REPLIES_HPP
 #define NUMERICAL_REPLIES_HPP
 
+#include "reply.hpp"
+
 /*
 | 引数名   | 意味                                    | 例                   |
 | ------- | -------------------------------------- | -------------------- |
@@ -12,112 +14,113 @@
 */
 // void	sendServerRpl(int const client_fd, std::string client_buffer);
 
-#define user_id(nickname, username) (":" + nickname + "!" + username + "@localhost")
-#define RPL_WELCOME(user_id, nickname) (":localhost 001 " + nickname + " :Welcome to the Internet Relay Network " + user_id + "\r\n")
-#define RPL_YOURHOST(client, servername, version) (":localhost 002 " + client + " :Your host is " + servername + " (localhost), running version " + version + "\r\n")
-#define RPL_CREATED(client, datetime) (":localhost 003 " + client + " :This server was created " + datetime + "\r\n")
-#define RPL_MYINFO(client, servername, version, user_modes, chan_modes, chan_param_modes) (":localhost 004 " + client + " " + servername + " " + version + " " + user_modes + " " + chan_modes + " " + chan_param_modes + "\r\n")
-#define RPL_ISUPPORT(client, tokens) (":localhost 005 " + client + " +" + tokens " :are supported by this server\r\n")
+#define user_id(nickname, username) (Reply() << ":" << nickname << "!" << username << "@localhost")
+#define RPL_WELCOME(user_id, nickname) (Reply() << ":localhost 001 " << nickname << " :Welcome to the Internet Relay Network " << user_id << "\r\n")
+#define RPL_YOURHOST(client, servername, version) (Reply() << ":localhost 002 " << client << " :Your host is " << servername << " (localhost), running version " << version << "\r\n")
+#define RPL_CREATED(client, datetime) (Reply() << ":localhost 003 " << client << " :This server was created " << datetime << "\r\n")
+#define RPL_MYINFO(client, servername, version, user_modes, chan_modes, chan_param_modes) (Reply() << ":localhost 004 " << client << " " << servername << " " << version << " " << user_modes << " " << chan_modes << " " << chan_param_modes << "\r\n")
+#define RPL_ISUPPORT(client, tokens) (Reply() << ":localhost 005 " << client << " " << tokens << " :are supported by this server\r\n")
 
-#define ERR_NOTREGISTERED(nickname) (":localhost 451 " + nickname + " :You have not registered\r\n")
+#define ERR_NOTREGISTERED(nickname) (Reply() << ":localhost 451 " << nickname << " :You have not registered\r\n")
 // #define ERR_NICKNAMEINUSE(nickname) (":localhost 433 " + nickname + " :Nickname is already in use\r\n")
 // #define ERR_NEEDMOREPARAMS(client, command) (":localhost 461 " + client + " " + command + " :Not enough parameters\r\n")
 // #define ERR_ALREADYREGISTERED(client) (":localhost 462 " + client + " :You may not reregister\r\n")
-#define ERR_UNKNOWNCOMMAND(client, command) (":localhost 421 " + client + " " + command + " :Unknown command\r\n")
+#define ERR_UNKNOWNCOMMAND(client, command) (Reply() << ":localhost 421 " << client << " " << command << " :Unknown command\r\n")
 
 // INVITE
-#define ERR_NEEDMOREPARAMS(client, command) (":localhost 461 " + client + " " + command + " :Not enough parameters.\r\n")
-#define ERR_NOSUCHCHANNEL(client, channel) (":localhost 403 " + client + " #" + channel + " :No such channel\r\n")
-#define ERR_NOTONCHANNEL(client, channel) (":localhost 442 " + client + " #" + channel + " :The user is not on this channel.\r\n")
-#define ERR_USERONCHANNEL(client, nick, channel) (":localhost 443 " + client + " " + nick + " #" + channel + " :Is already on channel\r\n")
-#define RPL_INVITING(user_id, client, nick, channel) (user_id + " 341 " + client + " " + nick + " #" + channel + "\r\n")
-#define RPL_INVITE(user_id, invited, channel) (user_id + " INVITE " + invited + " #" + channel + "\r\n")
+#define ERR_NEEDMOREPARAMS(client, command) (Reply() << ":localhost 461 " << client << " " << command << " :Not enough parameters.\r\n")
+#define ERR_NOSUCHCHANNEL(client, channel) (Reply() << ":localhost 403 " << client << " #" << channel << " :No such channel\r\n")
+#define ERR_NOTONCHANNEL(client, channel) (Reply() << ":localhost 442 " << client << " #" << channel << " :The user is not on this channel.\r\n")
+#define ERR_USERONCHANNEL(client, nick, channel) (Reply() << ":localhost 443 " << client << " " << nick << " #" << channel << " :Is already on channel\r\n")
+#define RPL_INVITING(user_id, client, nick, channel) (Reply() << user_id << " 341 " << client << " " << nick << " #" << channel << "\r\n")
+#define RPL_INVITE(user_id, invited, channel) (Reply() << user_id << " INVITE " << invited << " #" << channel << "\r\n")
 
 // JOIN
-#define RPL_JOIN(user_id, channel) (user_id + " JOIN #" + channel + "\r\n")
-#define ERR_BANNEDFROMCHAN(client, channel) ("474 " + client + " #" + channel + " :Cannot join channel (+b)\r\n")
-#define ERR_BADCHANNELKEY(client, channel) ("475 " + client + " #" + channel + " :Cannot join channel (+k)\r\n")
+#define RPL_JOIN(user_id, channel) (Reply() << user_id << " JOIN #" << channel << "\r\n")
+#define ERR_BANNEDFROMCHAN(client, channel) (Reply() << "474 " << client << " #" << channel << " :Cannot join channel (+b)\r\n")
+#define ERR_BADCHANNELKEY(client, channel) (Reply() << "475 " << client << " #" << channel << " :Cannot join channel (+k)\r\n")
 // #define ERR_CHANNELISFULL(client, channel) (client + " #" + channel + " :Cannot join channel (+l)\r\n")
-#define ERR_ALREADYJOINED(client, channel) (client + " #" + channel + " :alrady joined\r\n")
-#define ERR_INVITEONLYCHAN(client, channel) (client + " #" + channel + " :Cannot join channel (+i)\r\n")
+#define ERR_ALREADYJOINED(client, channel) (Reply() << client << " #" << channel << " :alrady joined\r\n")
+#define ERR_INVITEONLYCHAN(client, channel) (Reply() << client << " #" << channel << " :Cannot join channel (+i)\r\n")
 
 // KICK
-#define ERR_USERNOTINCHANNEL(client, nickname, channel) ("441 " + client + " " + nickname + " #" + channel + " :They aren't on that channel\r\n")
+#define ERR_USERNOTINCHANNEL(client, nickname, channel) (Reply() << "441 " << client << " " << nickname << " #" << channel << " :They aren't on that channel\r\n")
 // # define ERR_CHANOPRIVSNEEDED(client, channel) ("482 " + client + " #" +  channel + " :You're not channel operator\r\n")
-#define RPL_KICK(user_id, channel, kicked, reason) (user_id + " KICK #" + channel + " " + kicked + " " + reason + "\r\n")
+#define RPL_KICK(user_id, channel, kicked, reason) (Reply() << user_id << " KICK #" << channel << " " << kicked << " " << reason << "\r\n")
 
 // KILL
-#define ERR_NOPRIVILEGES(client) ("481 " + client + " :Permission Denied- You're not an IRC operator\r\n")
-#define RPL_KILL(user_id, killed, comment) (user_id + " KILL " + killed + " " + comment + "\r\n")
+#define ERR_NOPRIVILEGES(client) (Reply() << "481 " << client << " :Permission Denied- You're not an IRC operator\r\n")
+#define RPL_KILL(user_id, killed, comment) (Reply() << user_id << " KILL " << killed << " " << comment << "\r\n")
 
 // MODE
 /* user mode */
-#define MODE_USERMSG(client, mode) (":" + client + " MODE " + client + " :" + mode + "\r\n")
-#define ERR_UMODEUNKNOWNFLAG(client) (":localhost 501 " + client + " :Unknown MODE flag\r\n")
-#define ERR_USERSDONTMATCH(client) ("502 " + client + " :Cant change mode for other users\r\n")
-#define RPL_UMODEIS(client, mode) (":localhost 221 " + client + " " + mode + "\r\n")
+#define MODE_USERMSG(client, mode) (Reply() << ":" << client << " MODE " << client << " :" << mode << "\r\n")
+#define ERR_UMODEUNKNOWNFLAG(client) (Reply() << ":localhost 501 " << client << " :Unknown MODE flag\r\n")
+#define ERR_USERSDONTMATCH(client) (Reply() << "502 " << client << " :Cant change mode for other users\r\n")
+#define RPL_UMODEIS(client, mode) (Reply() << ":localhost 221 " << client << " " << mode << "\r\n")
 /* channel mode */
-#define MODE_CHANNELMSG(channel, mode) (":localhost MODE #" + channel + " " + mode + "\r\n")
-#define MODE_CHANNELMSGWITHPARAM(channel, mode, param) (":localhost MODE #" + channel + " " + mode + " " + param + "\r\n")
-#define RPL_CHANNELMODEIS(client, channel, mode) (":localhost 324 " + client + " #" + channel + " " + mode + "\r\n")
-#define RPL_CHANNELMODEISWITHKEY(client, channel, mode, password) (":localhost 324 " + client + " #" + channel + " " + mode + " " + password + "\r\n")
-#define ERR_CANNOTSENDTOCHAN(client, channel) ("404 " + client + " #" + channel + " :Cannot send to channel\r\n")
-#define ERR_CHANNELISFULL(client, channel) ("471 " + client + " #" + channel + " :Cannot join channel (+l)\r\n")
-#define ERR_CHANOPRIVSNEEDED(client, channel) (":localhost 482 " + client + " #" + channel + " :You're not channel operator\r\n")
-#define ERR_INVALIDMODEPARAM(client, channel, mode, password) ("696 " + client + " #" + channel + " " + mode + " " + password + " : password must only contained alphabetic character\r\n")
+#define MODE_CHANNELMSG(channel, mode) (Reply() << ":localhost MODE #" << channel << " " << mode << "\r\n")
+#define MODE_CHANNELMSGWITHPARAM(channel, mode, param) (Reply() << ":localhost MODE #" << channel << " " << mode << " " << param << "\r\n")
+#define RPL_CHANNELMODEIS(client, channel, mode) (Reply() << ":localhost 324 " << client << " #" << channel << " " << mode << "\r\n")
+#define RPL_CHANNELMODEISWITHKEY(client, channel, mode, password) (Reply() << ":localhost 324 " << client << " #" << channel << " " << mode << " " << password << "\r\n")
+#define ERR_CANNOTSENDTOCHAN(client, channel) (Reply() << "404 " << client << " #" << channel << " :Cannot send to channel\r\n")
+#define ERR_CHANNELISFULL(client, channel) (Reply() << "471 " << client << " #" << channel << " :Cannot join channel (+l)\r\n")
+#define ERR_CHANOPRIVSNEEDED(client, channel) (Reply() << ":localhost 482 " << client << " #" << channel << " :You're not channel operator\r\n")
+#define ERR_INVALIDMODEPARAM(client, channel, mode, password) (Reply() << "696 " << client << " #" << channel << " " << mode << " " << password << " : password must only contained alphabetic character\r\n")
 // RPL_ERR a broadcoast quand user pas +v ou operator veut parler
 // dans notre cas c'était tiff (client) qui voulait send a message
 // :lair.nl.eu.dal.net 404 tiff #pop :Cannot send to channel
-#define RPL_ADDVOICE(nickname, username, channel, mode, param) (":" + nickname + "!" + username + "@localhost MODE #" + channel + " " + mode + " " + param + "\r\n")
+#define RPL_ADDVOICE(nickname, username, channel, mode, param) (Reply() << ":" << nickname << "!" << username << "@localhost MODE #" << channel << " " << mode << " " << param << "\r\n")
 
 // MOTD
-#define ERR_NOSUCHSERVER(client, servername) (":localhost 402 " + client + " " + servername + " :No such server\r\n")
-#define ERR_NOMOTD(client) (":localhost 422 " + client + " :MOTD File is missing\r\n")
-#define RPL_MOTDSTART(client, servername) (":localhost 375 " + client + " :- " + servername + " Message of the day - \r\n")
-#define RPL_MOTD(client, motd_line) (":localhost 372 " + client + " :" + motd_line + "\r\n")
-#define RPL_ENDOFMOTD(client) (":localhost 376 " + client + " :End of /MOTD command.\r\n")
+#define ERR_NOSUCHSERVER(client, servername) (Reply() << ":localhost 402 " << client << " " << servername << " :No such server\r\n")
+#define ERR_NOMOTD(client) (Reply() << ":localhost 422 " << client << " :MOTD File is missing\r\n")
+#define RPL_MOTDSTART(client, servername) (Reply() << ":localhost 375 " << client << " :- " << servername << " Message of the day - \r\n")
+#define RPL_MOTD(client, motd_line) (Reply() << ":localhost 372 " << client << " :" << motd_line << "\r\n")
+#define RPL_ENDOFMOTD(client) (Reply() << ":localhost 376 " << client << " :End of /MOTD command.\r\n")
 
 // NAMES
-#define RPL_NAMREPLY(client, symbol, channel, list_of_nicks) (":localhost 353 " + client + " " + symbol + " #" + channel + " :" + list_of_nicks + "\r\n")
-#define RPL_ENDOFNAMES(client, channel) (":localhost 366 " + client + " #" + channel + " :End of /NAMES list.\r\n")
+#define RPL_NAMREPLY(client, symbol, channel, list_of_nicks) (Reply() << ":localhost 353 " << client << " " << symbol << " #" << channel << " :" << list_of_nicks << "\r\n")
+#define RPL_ENDOFNAMES(client, channel) (Reply() << ":localhost 366 " << client << " #" << channel << " :End of /NAMES list.\r\n")
 
 // NICK
-#define ERR_NONICKNAMEGIVEN(client) (":localhost 431 " + client + " :There is no nickname.\r\n")
-#define ERR_ERRONEUSNICKNAME(client, nickname) (":localhost 432 " + client + " " + nickname + " :Erroneus nickname\r\n")
-#define ERR_NICKNAMEINUSE(client, nickname) (":localhost 433 " + client + " " + nickname + " :Nickname is already in use.\r\n")
-#define RPL_NICK(oclient, uclient, client) (":" + oclient + "!" + uclient + "@localhost NICK " + client + "\r\n")
+#define ERR_NONICKNAMEGIVEN(client) (Reply() << ":localhost 431 " << client << " :There is no nickname.\r\n")
+#define ERR_ERRONEUSNICKNAME(client, nickname) (Reply() << ":localhost 432 " << client << " " << nickname << " :Erroneus nickname\r\n")
+#define ERR_NICKNAMEINUSE(client, nickname) (Reply() << ":localhost 433 " << client << " " << nickname << " :Nickname is already in use.\r\n")
+#define RPL_NICK(oclient, uclient, client) (Reply() << ":" << oclient << "!" << uclient << "@localhost NICK " << client << "\r\n")
 
 // NOTICE
-#define RPL_NOTICE(nick, username, target, message) (":" + nick + "!" + username + "@localhost NOTICE " + target + " " + message + "\r\n")
+#define RPL_NOTICE(nick, username, target, message) (Reply() << ":" << nick << "!" << username << "@localhost NOTICE " << target << " " << message << "\r\n")
 
 // OPER
-#define ERR_NOOPERHOST(client) ("491 " + client + " :No O-lines for your host\r\n")
-#define RPL_YOUREOPER(client) ("381 " + client + " :You are now an IRC operator\r\n")
+#define ERR_NOOPERHOST(client) (Reply() << "491 " << client << " :No O-lines for your host\r\n")
+#define RPL_YOUREOPER(client) (Reply() << "381 " << client << " :You are now an IRC operator\r\n")
 
 // PART
-#define RPL_PART(user_id, channel, reason) (user_id + " PART #" + channel + " " + (reason.empty() ? "." : reason) + "\r\n")
+#define RPL_PART(user_id, channel, reason) (Reply() << user_id << " PART #" << channel << " " << (reason.empty() ? "." : reason) << "\r\n")
 
 // PASS
-#define ERR_PASSWDMISMATCH(client) (":localhost 464 " + client + " :Password incorrect.\r\n")
+#define ERR_PASSWDMISMATCH(client) (Reply() << ":localhost 464 " << client << " :Password incorrect.\r\n")
 
 // PING
-#define RPL_PONG(user_id, msg) (user_id + msg + "\r\n")
+#define RPL_PONG(user_id, msg) (Reply() << user_id << msg << "\r\n")
 
 // QUIT
-#define RPL_QUIT(user_id, reason) (user_id + " QUIT :Quit: " + reason + "\r\n")
-#define RPL_ERROR(user_id, reason) (user_id + " ERROR :" + reason + "\r\n")
+#define RPL_QUIT(user_id, reason) (Reply() << user_id << " QUIT :Quit: " << reason << "\r\n")
+#define RPL_ERROR(user_id, reason) (Reply() << user_id << " ERROR :" << reason << "\r\n")
+#define RPL_CLOSINGLINK(host, reason) (Reply() << "ERROR :Closing Link: " << host << " (" << reason << ")\r\n")
 
 // PRIVMSG
-#define ERR_NOSUCHNICK(client, target) ("401 " + client + " " + target + " :No such nick/channel\r\n")
-#define ERR_NORECIPIENT(client) ("411 " + client + " :No recipient given PRIVMSG\r\n")
-#define ERR_NOTEXTTOSEND(client) ("412 " + client + " :No text to send\r\n")
-#define RPL_PRIVMSG(nick, username, target, message) (":" + nick + "!" + username + "@localhost PRIVMSG " + target + " :" + message + "\r\n")
+#define ERR_NOSUCHNICK(client, target) (Reply() << "401 " << client << " " << target << " :No such nick/channel\r\n")
+#define ERR_NORECIPIENT(client) (Reply() << "411 " << client << " :No recipient given PRIVMSG\r\n")
+#define ERR_NOTEXTTOSEND(client) (Reply() << "412 " << client << " :No text to send\r\n")
+#define RPL_PRIVMSG(nick, username, target, message) (Reply() << ":" << nick << "!" << username << "@localhost PRIVMSG " << target << " :" << message << "\r\n")
 
 // TOPIC
-#define RPL_TOPIC(client, channel, topic) (":localhost 332 " + client + " #" + channel + " :" + topic + "\r\n")
-#define RPL_NOTOPIC(client, channel) (":localhost 331 " + client + " #" + channel + " :No topic is set\r\n")
+#define RPL_TOPIC(client, channel, topic) (Reply() << ":localhost 332 " << client << " #" << channel << " :" << topic << "\r\n")
+#define RPL_NOTOPIC(client, channel) (Reply() << ":localhost 331 " << client << " #" << channel << " :No topic is set\r\n")
 
 // USER
-#define ERR_ALREADYREGISTERED(client) (":localhost 462 " + client + " :You may not reregister.\r\n")
+#define ERR_ALREADYREGISTERED(client) (Reply() << ":localhost 462 " << client << " :You may not reregister.\r\n")
 
 #endif
\ No newline at end of file
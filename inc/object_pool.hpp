@@ -0,0 +1,226 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   object_pool.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/12 15:06:27 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/12 15:06:27 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include "mutex.hpp"
+
+// プールの使用状況
+struct PoolStats
+{
+    size_t in_use;   // 使用中のオブジェクト数
+    size_t capacity; // 確保済みのスロット数（使用中 + 空き）
+    size_t slabs;    // 確保したスラブの数
+    size_t peak;     // in_use の最大値
+};
+
+// 全プール共通の部分。生きているプールは一覧に登録され、まとめて統計を取れる
+class ObjectPoolBase
+{
+private:
+    std::string _name;
+
+    static Mutex &registryLock()
+    {
+        static Mutex lock;
+        return lock;
+    }
+    static std::vector<ObjectPoolBase *> &registry()
+    {
+        static std::vector<ObjectPoolBase *> pools;
+        return pools;
+    }
+
+    ObjectPoolBase(const ObjectPoolBase &other);
+    ObjectPoolBase &operator=(const ObjectPoolBase &other);
+
+protected:
+    explicit ObjectPoolBase(const std::string &name) : _name(name)
+    {
+        ScopedLock lock(registryLock());
+        registry().push_back(this);
+    }
+    virtual ~ObjectPoolBase()
+    {
+        ScopedLock lock(registryLock());
+        std::vector<ObjectPoolBase *> &pools = registry();
+        pools.erase(std::find(pools.begin(), pools.end(), this));
+    }
+
+public:
+    const std::string &name() const { return _name; }
+    virtual PoolStats stats() const = 0;
+
+    // 登録されている全プールの (名前, 統計) を返す
+    static std::vector<std::pair<std::string, PoolStats> > allStats()
+    {
+        ScopedLock lock(registryLock());
+        std::vector<std::pair<std::string, PoolStats> > result;
+        const std::vector<ObjectPoolBase *> &pools = registry();
+        for (size_t i = 0; i < pools.size(); i++)
+            result.push_back(std::make_pair(pools[i]->name(), pools[i]->stats()));
+        return result;
+    }
+};
+
+// 同じ大きさのオブジェクトをスラブ単位でまとめて確保し、解放されたスロットは free list で使い回す
+// 接続の出入りが激しくてもヒープが細切れにならず、RSS はピーク時の使用量で頭打ちになる
+// スラブは pool が破棄されるまで返さない
+template <typename T>
+class ObjectPool : public ObjectPoolBase
+{
+private:
+    // 空きスロットは先頭に次の空きスロットへのポインタを持つ
+    union Slot
+    {
+        Slot *next;
+        char storage[sizeof(T)];
+        double align_double; //-> T のアラインメントを満たすためのメンバー
+        void *align_pointer;
+    };
+
+    std::vector<Slot *> _slabs;
+    Slot *_free;
+    size_t _per_slab;
+    size_t _in_use;
+    size_t _peak;
+    mutable Mutex _mutex; //-> 複数のイベントループスレッドから使われる
+
+    ObjectPool(const ObjectPool &other);
+    ObjectPool &operator=(const ObjectPool &other);
+
+    void grow()
+    {
+        Slot *slab = static_cast<Slot *>(::operator new(sizeof(Slot) * _per_slab));
+        _slabs.push_back(slab);
+        for (size_t i = _per_slab; i > 0; i--)
+        {
+            slab[i - 1].next = _free;
+            _free = &slab[i - 1];
+        }
+    }
+
+public:
+    explicit ObjectPool(const std::string &name, size_t per_slab = 64)
+        : ObjectPoolBase(name), _free(NULL), _per_slab(per_slab), _in_use(0), _peak(0) {}
+    ~ObjectPool()
+    {
+        for (size_t i = 0; i < _slabs.size(); i++)
+            ::operator delete(_slabs[i]);
+    }
+
+    // T 1 個分の未初期化領域を返す（構築は呼び出し側の placement new / operator new で行う）
+    void *allocate()
+    {
+        ScopedLock lock(_mutex);
+        if (!_free)
+            grow();
+        Slot *slot = _free;
+        _free = slot->next;
+        if (++_in_use > _peak)
+            _peak = _in_use;
+        return slot;
+    }
+
+    void deallocate(void *ptr)
+    {
+        if (!ptr)
+            return;
+        ScopedLock lock(_mutex);
+        Slot *slot = static_cast<Slot *>(ptr);
+        slot->next = _free;
+        _free = slot;
+        _in_use--;
+    }
+
+    PoolStats stats() const
+    {
+        ScopedLock lock(_mutex);
+        PoolStats stats;
+        stats.in_use = _in_use;
+        stats.capacity = _slabs.size() * _per_slab;
+        stats.slabs = _slabs.size();
+        stats.peak = _peak;
+        return stats;
+    }
+};
+
+// 1 要素ずつ確保するコンテナ（std::map / std::set のノード）を ObjectPool に載せる STL アロケーター
+// ノードの型ごとに 1 つのプールを共有する
+template <typename T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef PoolAllocator<U> other;
+    };
+
+    PoolAllocator() {}
+    PoolAllocator(const PoolAllocator &) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+    ~PoolAllocator() {}
+
+    static ObjectPool<T> &pool()
+    {
+        static ObjectPool<T> instance(nodePoolName());
+        return instance;
+    }
+    static std::string nodePoolName()
+    {
+        std::ostringstream name;
+        name << "node" << sizeof(T);
+        return name.str();
+    }
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(size_type n, const void * = 0)
+    {
+        if (n == 1)
+            return static_cast<pointer>(pool().allocate());
+        return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(pointer ptr, size_type n)
+    {
+        if (n == 1)
+            pool().deallocate(ptr);
+        else
+            ::operator delete(ptr);
+    }
+
+    size_type max_size() const { return size_t(-1) / sizeof(T); }
+    void construct(pointer ptr, const T &value) { new (static_cast<void *>(ptr)) T(value); }
+    void destroy(pointer ptr) { ptr->~T(); }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) { return false; }
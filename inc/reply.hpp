@@ -0,0 +1,57 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   reply.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/11 16:45:02 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/11 16:45:02 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <cstring>
+
+#define REPLY_INLINE_SIZE 512 //-> IRC の 1 行の最大長。これを超える行だけ std::string に移す
+#define REPLY_NICK_MARKER "\x01" //-> テンプレートを作る時にニックネームの位置に入れる目印
+
+// ニックネームだけが宛先ごとに変わる定型の返信
+// 起動時にマクロへ目印を渡して 1 度だけ整形し、目印の前後を保存しておく
+struct ReplyTemplate
+{
+    std::string head; //-> ニックネームより前
+    std::string tail; //-> ニックネームより後
+
+    ReplyTemplate() {}
+    explicit ReplyTemplate(const std::string &line);
+};
+
+// 返信 1 行を組み立てるバッファ
+// numerical_replies.hpp のマクロは Reply() << a << b ... の形で 1 つのバッファに書き込むので、
+// std::string の operator+ のように連結ごとの一時オブジェクトを作らない。
+// addToClientBuffer(fd, const Reply &) はこのバッファから直接送信キューにコピーする。
+class Reply
+{
+private:
+    char _inline[REPLY_INLINE_SIZE];
+    std::string _overflow; //-> REPLY_INLINE_SIZE を超えた場合だけ使う
+    size_t _size;
+
+    Reply &append(const char *data, size_t size);
+
+public:
+    Reply() : _size(0) {}
+
+    Reply &operator<<(const std::string &str) { return append(str.data(), str.size()); }
+    Reply &operator<<(const char *str) { return append(str, strlen(str)); }
+    Reply &operator<<(char c) { return append(&c, 1); }
+    Reply &operator<<(const Reply &other) { return append(other.data(), other.size()); }
+    Reply &format(const ReplyTemplate &tpl, const std::string &nick); //-> テンプレートに宛先を埋めて追加
+
+    const char *data() const { return _overflow.empty() ? _inline : _overflow.data(); }
+    size_t size() const { return _size; }
+    operator std::string() const { return std::string(data(), _size); } //-> 文字列として使う箇所との互換用
+};
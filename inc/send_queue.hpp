@@ -0,0 +1,91 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   send_queue.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/07 11:03:48 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/07 11:03:48 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "irc.hpp"
+#include "mutex.hpp"
+
+#include <climits>   //-> for IOV_MAX
+#include <sys/uio.h> //-> for writev()
+
+// 複数のクライアントで共有する、整形済みの不変メッセージ
+// チャンネルへの broadcast では 1 つのメッセージを全員の送信キューが参照する
+class SharedMessage
+{
+private:
+    std::string _data; //-> 送信する 1 行 (\r\n 込み)
+    int _refs;         //-> 参照カウント（スレッド間で共有されるので atomic に増減する）
+
+    SharedMessage(const std::string &data);
+    SharedMessage(const SharedMessage &other);
+    SharedMessage &operator=(const SharedMessage &other);
+    ~SharedMessage();
+
+public:
+    // 参照カウント 1 で生成する。使い終わったら release() すること
+    static SharedMessage *create(const std::string &data);
+
+    void retain();
+    void release(); //-> 参照カウントが 0 になったら自分を解放する
+
+    const char *data() const;
+    size_t size() const;
+};
+
+// クライアントごとの送信キュー
+// セグメントの連結リストで、先頭セグメントの読み出し位置 (begin) だけを進めていく。
+// 送信済み部分を erase で詰め直さないので、大量に溜まっても部分送信が O(1) で済む。
+//  - 共有セグメント: broadcast された SharedMessage を参照する
+//  - 個別セグメント: 1 人宛ての短い行を固定長のチャンクに追記していく
+class SendQueue
+{
+private:
+    struct Segment
+    {
+        SharedMessage *msg; //-> 共有メッセージ (個別セグメントなら NULL)
+        char *chunk;        //-> 個別セグメントのデータ領域
+        size_t begin;       //-> 次に送る位置（読み出しカーソル）
+        size_t end;         //-> データの終端
+        size_t count;       //-> セグメントに含まれるメッセージ数
+        Segment *next;
+    };
+    Segment *_head;
+    Segment *_tail;
+    size_t _bytes;    //-> 未送信バイト数
+    size_t _messages; //-> 未送信メッセージ数（送り切ったセグメント単位で減る）
+    mutable Mutex _mutex; //-> 追加するスレッドと送信するスレッドが違う場合がある（コピーしない）
+
+    Segment *newSegment();
+    void append(Segment *seg);
+    void popFront();
+    static const char *segmentData(const Segment *seg);
+
+public:
+    SendQueue();
+    SendQueue(const SendQueue &other);
+    SendQueue &operator=(const SendQueue &other);
+    ~SendQueue();
+
+    void push(SharedMessage *msg);          //-> 参照を 1 つ増やしてキューに追加
+    void push(const std::string &message); //-> 末尾のチャンクにコピーして追加
+    void push(const char *data, size_t size);
+    bool empty() const;
+    size_t bytes() const;    //-> 未送信バイト数
+    size_t messages() const; //-> 未送信メッセージ数
+    void clear();
+    size_t dropUnsent(); //-> 送信途中の先頭行の残りだけを残して捨て、捨てたバイト数を返す
+    Mutex &mutex() const; //-> 操作する間はこれをロックしておく
+
+    // 送れるだけ送る。送信したバイト数、エラー時は -1 (errno を参照) を返す
+    ssize_t flush(int fd);
+};
@@ -13,6 +13,17 @@
 #pragma once
 
 #include "irc.hpp"
+#include "config.hpp"
+#include "event_loop.hpp"
+#include "send_queue.hpp"
+#include "line_buffer.hpp"
+#include "connection.hpp"
+#include "metrics.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+#include "nick_index.hpp"
+#include "mutex.hpp"
+#include "reply.hpp"
 // #include "client.hpp" //-> include client.hpp
 // #include "channel.hpp"
 // #include "command.hpp"
@@ -63,18 +74,55 @@
 
 class Channel; // Forward declaration of Channel class
 class Client;  // Forward declaration of Client class
+struct CommandEntry;
+class Server;
+
+// ソケット入出力用のイベントループ 1 本分。1 つのスレッドが担当し、割り当てられた fd だけを監視する
+// epoll_wait・recv・writev だけがスレッドごとに並んで動き、コマンドは _registry_lock の下で 1 つずつ処理される
+// worker 0 はメインスレッドで動き、待ち受けソケットも担当する
+struct Worker
+{
+    Server *server;
+    size_t id;
+    EventLoop *loop;
+    pthread_t thread;
+    bool running;                           //-> pthread_create 済み（worker 0 は常に false）
+    int wake_fds[2];                        //-> 他スレッドから起こすためのパイプ
+    std::vector<IoEvent> events;            //-> wait() で受け取ったイベント
+    std::vector<int> disconnected;          //-> 切断予約された fd（_registry_lock で保護）
+    std::vector<int> armed;                 //-> 他スレッドが書き込み監視を頼んだ fd（_registry_lock で保護）
+    RecvBufferPool recv_pool;               //-> 担当する接続の受信バッファの記憶領域
+    std::set<std::pair<unsigned long, int> > timers; //-> flood 制御で止めている (再開時刻, fd) の早い順
+    std::vector<int> ready;                 //-> 行数の上限で処理を打ち切った fd（次のループで続きを処理）
+    WorkerMetrics metrics;                  //-> このスレッドの計測値（書き込むのはこのスレッドだけ）
+    LoopTrace trace;                        //-> 今の周回の区間ごとの時間（遅延の検出とトレース）
+};
 
 class Server //-> class for server
 {
 private:
     int _port;                                  //-> server port
     int _serSocketFd;                           //-> server socket file descriptor
-    static bool _signal;                        //-> static boolean for signal
-    std::vector<struct pollfd> _fds;            //-> vector of pollfd
-    std::map<int, Client *> _clients;           //-> vector of clients
+    static volatile sig_atomic_t _signal;       //-> 停止要求（シグナルハンドラと全スレッドから __atomic で読み書きする）
+    ServerConfig _config;                       //-> 起動オプション
+    std::vector<Worker *> _workers;             //-> イベントループのスレッド (epoll / poll)
+    size_t _next_worker;                        //-> 次の接続を割り当てるスレッド
+    Mutex _registry_lock;                       //-> クライアント・チャンネル・ニックネーム・接続の受け付けと切断を保護する（コマンドは全スレッドで直列）
+    size_t _sendq_dropped_bytes;                //-> 送信キュー上限で破棄したバイト数
+    size_t _sendq_disconnects;                  //-> Max SendQ exceeded で切断した数
+    time_t _accept_window;                      //-> 接続数を数えている 1 秒間
+    size_t _accept_count;                       //-> その 1 秒間に受け付けた接続数
+    std::map<in_addr_t, size_t> _accept_per_ip; //-> その 1 秒間の接続元 IP ごとの接続数
+    size_t _accept_throttled;                   //-> 接続レート超過で拒否した数
+    SharedMessage *_welcome;                    //-> 接続直後に送るメッセージ（全員で共有）
+    std::string _created;                       //-> サーバーの起動日時 (RPL_CREATED 用)
+    std::vector<ReplyTemplate> _burst;          //-> 登録完了時の 002〜005（起動時に整形済み）
+    ConnectionTable _connections;               //-> fd → 接続ごとの状態（Client・送受信バッファ・担当スレッド）
+    size_t _client_count;                       //-> 接続中のクライアント数
+    MetricsEndpoint _metrics;                   //-> /metrics の待ち受け（worker 0 だけが触る）
+    TraceFile _trace_file;                      //-> Chrome のトレースの書き出し先（--trace-file）
+    NickIndex _nicknames;                       //-> ニックネーム → Client*（casemapping 済み）
     std::map<std::string, Channel *> _channels; // channel name → Channel*
-    std::map<int, std::string> _send_buffers;   // fd → message buffer
-    std::map<int, std::string> _recv_buffers;   // 受信バッファ
     std::string _password;
     // std::vector<server_op> _operators; //-> vector of server operators
 
@@ -86,44 +134,86 @@ public:
     // サーバー初期化→起動
     // void serverInit(const std::string &port, const std::string &password, const std::tm *timeinfo); //-> initialize the server
     void serverInit(const char *port, const char *password, struct tm *timeinfo);
+    void setConfig(const ServerConfig &config); //-> 起動オプションを設定
     // ソケット通信関連
     int getPort() const;                      //-> getter for port
     struct in_addr getIpAdd() const;          //-> getter for ip address
     void serSocket();                         //-> server socket creation
-    void handleSocketReadable(int client_fd); //-> handle socket readable
+    void handleSocketReadable(Worker &worker, int client_fd); //-> handle socket readable
+    bool processLines(Worker &worker, Connection &conn); //-> 溜まった行を処理（続けて読めるなら true）
     static void signalHandler(int signum);    //-> signal handler
     void closeFds();                          //-> close file descriptors
 
+    // スレッド関連（I/O のオフロード）
+    // 複数のスレッドに分けるのはソケットの待ち受けと読み書きだけで、コマンドの処理・accept・切断の後始末は
+    // _registry_lock を保持して 1 つずつ行う。送信キューはそれぞれのロックで保護する
+    void addWorker();                  //-> イベントループを 1 本追加
+    void startWorkers();               //-> worker 1 以降のスレッドを起動
+    void stopWorkers();                //-> 全スレッドを起こして終了を待つ
+    void runWorker(Worker &worker);    //-> イベントループ本体
+    void wakeWorker(Worker &worker);   //-> wait() 中のスレッドを起こす
+    static void *workerMain(void *arg); //-> pthread_create のエントリポイント
+
+    // flood 制御 (fake lag)
+    void chargeFlood(Client *client, unsigned int cost);          //-> コマンド分のトークンを消費
+    bool isFlooding(Client *client, unsigned long &resume_at);    //-> 予算切れなら再開時刻を返す
+    void pauseInput(Worker &worker, Connection &conn, unsigned long resume_at); //-> 入力の処理を止める
+    void runTimers(Worker &worker);                               //-> 再開時刻になった fd を処理する
+    void runReady(Worker &worker);                                //-> ready の fd を 1 巡だけ処理する
+    int nextTimeout(const Worker &worker) const;                  //-> wait() に渡すタイムアウト (ms)
+
     void setPassword(const std::string &password); //-> set server password
     const std::string &getPassword() const;        //-> get server password
 
     // メッセージ解析
-    void handleClientRegistrationCommand(std::map<int, Client *> &client, int client_fd, ParsedMessage &msg);
-    void handleClientMessage(const std::string &line, int client_fd);
-    void executeCommand(ParsedMessage &msg, int client_fd); //-> execute command
+    void handleClientRegistrationCommand(Client *client, int client_fd, const CommandEntry *entry, const MessageView &view);
+    CommandIndex handleClientMessage(const StringView &line, int client_fd); //-> 実行したコマンドを返す
+    void executeCommand(const CommandEntry *entry, const MessageView &view, int client_fd); //-> execute command
 
     // クライアント関連
     void acceptNewClient();    //-> accept new client
-    void clearClients(int fd); //-> clear clients
+    bool isAcceptThrottled(in_addr_t ip); //-> 接続レートの上限を超えているか
+    void clearClients(int fd); //-> 切断を予約する
+    void reapClients(Worker &worker);   //-> 切断予約されたクライアントを削除
+    void destroyClient(Worker &worker, int fd); //-> クライアントを削除してソケットを閉じる
     Client *getClient(int fd); //-> get client by file descriptor
+    Connection *getConnection(Worker &worker, int fd); //-> worker が担当する接続を取得（担当スレッドから）
+    int getFdLimit() const;    //-> 0 〜 getFdLimit() - 1 を getClient すれば全クライアントを見られる
     // void removeClient(int client_fd); //-> remove client by file descriptor
     // void addClient(const Client& client); //-> add client to server
     Client *getClientByNickname(const std::string &nickname); //-> get client by nickname
-    std::map<int, Client *> getClients();                     //-> get all clients
+    bool setClientNickname(Client *client, const std::string &nickname); //-> 索引を更新してニックネームを変更
+    size_t getClientCount() const;                            //-> 接続中のクライアント数
 
     // チャンネル関連
     void addChannel(Channel *channel);                    //-> add channel to server
     Channel *getChannel(const std::string &channel_name); //-> get channel by name
-    std::map<std::string, Channel *> getChannels();       //-> get all channels
+    const std::map<std::string, Channel *> &getChannels() const; //-> get all channels
+    size_t getChannelCount() const;                       //-> チャンネル数
     void removeChannel(const std::string &channel_name);  //-> remove channel by name
     void clearChannels();                                 //-> clear all channels
+    void logPoolStats() const;                            //-> オブジェクトプールの使用状況を表示
+
+    // 計測値 (Prometheus)
+    void handleMetricsEvent(int fd, int events); //-> /metrics の接続のイベントを処理
+    std::string renderMetrics();                 //-> 全スレッドの計測値を足し合わせてテキスト形式で返す
+    void reportStall(Worker &worker);            //-> 予算を超えた周回の内訳と最も遅かったコマンドをログに出す
 
     // メッセージ送信バッファ
     void addToClientBuffer(int client_fd, const std::string &message); //-> add message to client buffer
-    void sendBuffer(int fd);                                           //-> send buffered messages to clients
-    std::string getSendBuffer(int client_fd) const;                    //-> get client buffer
+    void addToClientBuffer(int client_fd, SharedMessage *message);      //-> 共有メッセージを送信キューに追加
+    void addToClientBuffer(int client_fd, const Reply &reply);          //-> 組み立てた返信をそのまま送信キューに追加
+    void sendBuffer(Worker &worker, int fd);                           //-> send buffered messages to clients
+    void armWrite(int client_fd);                                      //-> 担当スレッドに書き込み監視を登録させる
+    void armRequestedWrites(Worker &worker);                           //-> 他スレッドに頼まれた書き込み監視を登録
+    SendQueue *getSendQueue(int client_fd);                            //-> 追加先の送信キューを取得
+    bool reserveSendQueue(int client_fd, SendQueue &queue, size_t incoming); //-> 上限を確認して書き込み監視を登録
     // std::string getCientBuffer(int client_fd) const;                   //-> get client buffer
     // void clearClientBuffer(int client_fd);                             //-> clear client buffer
     // void sendBufferedMessages(); //-> send buffered messages to clients
     std::string _welcomemsg(void);
+
+    // 定型の返信
+    void buildReplyCache(struct tm *timeinfo);                      //-> 起動時に定型部分を整形しておく
+    void appendRegistrationBurst(Reply &reply, const std::string &nick) const; //-> 002〜005 を追加
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   trace.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/16 16:08:52 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/16 16:08:52 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "irc.hpp"
+#include "mutex.hpp"
+
+#define TRACE_LINE_MAX 128      //-> 遅延報告用に控えておく行の先頭のバイト数
+#define TRACE_NICK_MAX 32       //-> 遅延報告用に控えておくニックネームの最大長
+#define TRACE_FLUSH_BYTES 65536 //-> スレッドごとに溜めたトレースをファイルに書き出す大きさ
+
+// イベントループ 1 周の区間
+enum TracePhase
+{
+    PHASE_WAIT,     //-> wait() で待っている時間
+    PHASE_ACCEPT,   //-> 新しい接続の受け付け
+    PHASE_READ,     //-> recv と行の切り出し（コマンドの実行は含まない）
+    PHASE_DISPATCH, //-> コマンドの解析と実行
+    PHASE_FLUSH,    //-> 送信キューの書き出し
+    PHASE_REAP,     //-> 切断されたクライアントの削除
+    PHASE_OTHER,    //-> スレッドの起床や /metrics など
+    PHASE_COUNT
+};
+
+const char *tracePhaseName(TracePhase phase);
+
+// Chrome のトレース (chrome://tracing, Perfetto で開ける JSON) の書き出し先
+// 各スレッドは自分のバッファに溜め、TRACE_FLUSH_BYTES ごとにロックを取って追記する
+class TraceFile
+{
+private:
+    int _fd;
+    bool _first; //-> まだ 1 件も書いていない（区切りの , を付けない）
+    Mutex _lock;
+
+    TraceFile(const TraceFile &other);
+    TraceFile &operator=(const TraceFile &other);
+
+public:
+    TraceFile();
+    ~TraceFile();
+
+    void open(const std::string &path); //-> 開けなければ runtime_error
+    void close();                       //-> 配列を閉じる
+    bool enabled() const { return _fd != -1; }
+    void append(std::string &events);   //-> ",\n" 区切りのイベントを追記して events を空にする
+};
+
+// イベントループ 1 周分の計測
+// mark() は直前の区間の時間を加算して次の区間に移る。時刻を読むのは区間が変わる時だけなので、
+// 同じ種類のイベントが続く間は何もしない。1 周の処理時間が予算を超えたら、
+// 最も遅かったコマンド（接続・コマンド・行の先頭）を Server::reportStall で報告する
+struct LoopTrace
+{
+    size_t worker;                        //-> トレースのスレッド番号 (tid)
+    TracePhase current;                   //-> 今いる区間
+    unsigned long begin;                  //-> 1 周の開始時刻 (ns)
+    unsigned long last;                   //-> 直前に区間が変わった時刻 (ns)
+    unsigned long phase_time[PHASE_COUNT];
+    size_t events;                        //-> wait() が返したイベント数
+    size_t commands;                      //-> 実行したコマンド数
+
+    unsigned long slowest;                //-> 最も遅かったコマンドの処理時間 (ns)
+    int slowest_fd;
+    unsigned long slowest_client;         //-> Client::getId()（報告までに fd が使い回されても取り違えない）
+    char slowest_nick[TRACE_NICK_MAX + 1]; //-> 実行した時点のニックネーム
+    CommandIndex slowest_command;
+    char slowest_line[TRACE_LINE_MAX];    //-> その行の先頭（宛先のチャンネルを後で調べる）
+    size_t slowest_size;
+
+    TraceFile *file;                      //-> NULL ならトレースを書き出さない
+    std::string pending;                  //-> file に書き出す前のイベント
+
+    LoopTrace();
+
+    void start();                           //-> 1 周の始まり（wait の前）
+    unsigned long mark(TracePhase next);    //-> 区間を移り、現在時刻を返す
+    void enter(TracePhase next)             //-> 区間が変わる時だけ mark する
+    {
+        if (next != current)
+            mark(next);
+    }
+    unsigned long busy() const;             //-> wait を除いた処理時間 (ns)
+    // 1 つのコマンドの処理を記録する（start / end は mark の戻り値）
+    // 誰のコマンドかは fd ではなく、実行した時点の client_id と nick で控える
+    void command(int fd, unsigned long client_id, const std::string &nick, CommandIndex index, const StringView &line,
+                 unsigned long start, unsigned long end);
+    void finish();                          //-> 1 周の終わり。トレースを書き出す
+    void flush();                           //-> 溜めたトレースを file に書き出す
+};
@@ -14,8 +14,32 @@
 #include "server.hpp"
 #include "channel.hpp"
 
+#include <algorithm> //-> for lower_bound()
+
 Channel::Channel(const std::string &name)
-    : _name(name), _topic(""), _password(""), _userLimit(-1), _inviteOnly(false) {}
+    : _name(name), _topic(""), _password(""), _userLimit(-1), _operatorCount(0), _modes(0) {}
+
+static ObjectPool<Channel> g_channel_pool("Channel");
+
+void *Channel::operator new(size_t size)
+{
+    if (size != sizeof(Channel))
+        return ::operator new(size); // 派生クラスは通常のヒープから
+    return g_channel_pool.allocate();
+}
+
+void Channel::operator delete(void *ptr, size_t size)
+{
+    if (size != sizeof(Channel))
+        ::operator delete(ptr);
+    else
+        g_channel_pool.deallocate(ptr);
+}
+
+PoolStats Channel::poolStats()
+{
+    return g_channel_pool.stats();
+}
 
 // 基本情報
 const std::string &Channel::getName() const
@@ -31,44 +55,86 @@ void Channel::setTopic(const std::string &topic)
     _topic = topic;
 }
 
+// 参加者の検索（見つからなければ id を挿入すべき位置を返す）
+static bool memberIdLess(const ChannelMember &member, unsigned long id)
+{
+    return member.id < id;
+}
+std::vector<ChannelMember>::iterator Channel::findMember(unsigned long id)
+{
+    return std::lower_bound(_members.begin(), _members.end(), id, memberIdLess);
+}
+std::vector<ChannelMember>::const_iterator Channel::findMember(unsigned long id) const
+{
+    return std::lower_bound(_members.begin(), _members.end(), id, memberIdLess);
+}
+
 // クライアント操作
 void Channel::addClient(Client &client)
 {
-    _clients[client.getNickname()] = &client;
+    std::vector<ChannelMember>::iterator it = findMember(client.getId());
+    if (it == _members.end() || it->id != client.getId())
+    {
+        ChannelMember member;
+        member.id = client.getId();
+        member.client = &client;
+        member.flags = 0;
+        _members.insert(it, member);
+    }
     client.addChannel(this); // クライアントのチャンネルリストに追加
 }
 void Channel::removeClient(Client &client)
 {
-    _clients.erase(client.getNickname());
-    _operators.erase(client.getNickname());
+    std::vector<ChannelMember>::iterator it = findMember(client.getId());
+    if (it != _members.end() && it->id == client.getId())
+    {
+        if (it->flags & MEMBER_OPERATOR)
+            _operatorCount--;
+        _members.erase(it);
+    }
+    _inviteList.erase(client.getId());
     client.removeChannel(this); // クライアントのチャンネルリストから削除
 }
 bool Channel::hasClient(const Client &client) const
 {
-    return _clients.find(client.getNickname()) != _clients.end();
+    std::vector<ChannelMember>::const_iterator it = findMember(client.getId());
+    return it != _members.end() && it->id == client.getId();
 }
 
 // オペレータ管理
-void Channel::addOperator(const std::string &nickname)
+void Channel::addOperator(const Client &client)
 {
-    std::cout << "Adding operator: " << nickname << " to channel: " << _name << std::endl;
-    _operators.insert(nickname);
+    std::vector<ChannelMember>::iterator it = findMember(client.getId());
+    if (it == _members.end() || it->id != client.getId() || (it->flags & MEMBER_OPERATOR))
+        return;
+    LOG_DEBUG("Adding operator: " << client.getNickname() << " to channel: " << _name);
+    it->flags |= MEMBER_OPERATOR;
+    _operatorCount++;
 }
-void Channel::removeOperator(const std::string &nickname)
+void Channel::removeOperator(const Client &client)
 {
-    std::cout << "Removing operator: " << nickname << " from channel: " << _name << std::endl;
-    _operators.erase(nickname);
+    std::vector<ChannelMember>::iterator it = findMember(client.getId());
+    if (it == _members.end() || it->id != client.getId() || !(it->flags & MEMBER_OPERATOR))
+        return;
+    LOG_DEBUG("Removing operator: " << client.getNickname() << " from channel: " << _name);
+    it->flags &= ~MEMBER_OPERATOR;
+    _operatorCount--;
 }
-bool Channel::isOperator(const std::string &nickname) const
+bool Channel::isOperator(const Client &client) const
 {
-    return _operators.find(nickname) != _operators.end();
+    std::vector<ChannelMember>::const_iterator it = findMember(client.getId());
+    return it != _members.end() && it->id == client.getId() && (it->flags & MEMBER_OPERATOR);
+}
+size_t Channel::getOperatorCount() const
+{
+    return _operatorCount;
 }
 
 // パスワード管理
 void Channel::setPassword(const std::string &password)
 {
     _password = password;
-    addMode('k'); // パスワードが設定された場合、+k モードを追加
+    addMode(CHANMODE_KEY); // パスワードが設定された場合、+k モードを追加
 }
 const std::string &Channel::getPassword() const
 {
@@ -78,43 +144,39 @@ const std::string &Channel::getPassword() const
 void Channel::removePassword()
 {
     _password = "";  // パスワードを空にする
-    removeMode('k'); // パスワードが削除された場合、+k モードを削除
+    removeMode(CHANMODE_KEY); // パスワードが削除された場合、+k モードを削除
 }
 
 // モード管理
-void Channel::addMode(char mode)
+void Channel::addMode(ModeMask mode)
 {
-    if (_modes.find(mode) == _modes.end())
-    {
-        _modes.insert(mode); // モードがまだ存在しない場合のみ追加
-    }
-    if (mode == 'i')
-    {
-        _inviteOnly = true; // +i モードが追加された場合、招待制に設定
-    }
+    if ((_modes | mode) == _modes)
+        return; // 変化がなければ文字列も作り直さない
+    _modes |= mode;
+    _modeString = modeMaskToString(_modes);
 }
-void Channel::removeMode(char mode)
+void Channel::removeMode(ModeMask mode)
 {
-    std::set<char>::iterator it = _modes.find(mode);
-    if (it != _modes.end())
-    {
-        _modes.erase(it, _modes.end());
-    }
-    if (mode == 'i')
-    {
-        _inviteOnly = false; // +i モードが削除された場合、招待制を解除
-    }
+    if ((_modes & ~mode) == _modes)
+        return;
+    _modes &= ~mode;
+    _modeString = modeMaskToString(_modes);
 }
-bool Channel::hasMode(char mode) const
+bool Channel::hasMode(ModeMask mode) const
 {
-    return _modes.find(mode) != _modes.end();
+    return (_modes & mode) != 0;
 }
 
-std::set<char> Channel::getModes() const
+ModeMask Channel::getModes() const
 {
     return _modes;
 }
 
+const std::string &Channel::getModeString() const
+{
+    return _modeString;
+}
+
 // BAN管理
 // void Channel::ban(const std::string &nickname)
 // {
@@ -134,21 +196,21 @@ std::set<char> Channel::getModes() const
 //     return _banList.find(nickname) != _banList.end();
 // }
 
-void Channel::addInvite(const std::string &nickname)
+void Channel::addInvite(const Client &client)
 {
-    _inviteList.insert(nickname);
+    _inviteList.insert(client.getId());
 }
-void Channel::removeInvite(const std::string &nickname)
+void Channel::removeInvite(const Client &client)
 {
-    _inviteList.erase(nickname);
+    _inviteList.erase(client.getId());
 }
 bool Channel::isInviteOnly() const
 {
-    return _inviteOnly;
+    return hasMode(CHANMODE_INVITE);
 }
-bool Channel::isInvited(const std::string &nickname) const
+bool Channel::isInvited(const Client &client) const
 {
-    return _inviteList.find(nickname) != _inviteList.end();
+    return _inviteList.find(client.getId()) != _inviteList.end();
 }
 
 // 容量制限
@@ -156,9 +218,9 @@ void Channel::setUserLimit(int limit)
 {
     _userLimit = limit;
     if (limit > 0)
-        addMode('l'); // +l モードを追加
+        addMode(CHANMODE_LIMIT); // +l モードを追加
     else
-        removeMode('l'); // 制限なしの場合、+l モードを削除
+        removeMode(CHANMODE_LIMIT); // 制限なしの場合、+l モードを削除
 }
 int Channel::getUserLimit() const
 {
@@ -166,26 +228,28 @@ int Channel::getUserLimit() const
 }
 
 // メンバー一覧取得
-std::map<std::string, Client *> Channel::getClients() const
+const std::vector<ChannelMember> &Channel::getMembers() const
 {
-    return _clients;
-}
-
-std::set<std::string> Channel::getOperators() const
-{
-    return _operators;
+    return _members;
 }
 // その他
 bool Channel::empty() const
 {
-    return _clients.empty();
+    return _members.empty();
+}
+size_t Channel::size() const
+{
+    return _members.size();
 }
 
 void Channel::broadcast(Server *server, const std::string &message)
 {
-    const std::map<std::string, Client *> &members = this->getClients();
-    for (std::map<std::string, Client *>::const_iterator member = members.begin(); member != members.end(); ++member)
+    // 整形済みメッセージは 1 つだけ作り、全員の送信キューから参照させる
+    SharedMessage *shared = SharedMessage::create(message);
+    // 切断は予約だけなので、送信中に _members が変わることはない
+    for (std::vector<ChannelMember>::const_iterator member = _members.begin(); member != _members.end(); ++member)
     {
-        server->addToClientBuffer(member->second->getFd(), message);
+        server->addToClientBuffer(member->client->getFd(), shared);
     }
+    shared->release();
 }
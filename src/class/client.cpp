@@ -14,75 +14,95 @@
 #include "server.hpp"
 #include "client.hpp"
 
-Client::Client() : _fd(-1), _ipAdd(""), _nickname(""), _username(""),
-                   _realname(""), _connexion_password(false),
+// 複数のイベントループスレッドから生成されうるので atomic に採番する
+static unsigned long nextClientId()
+{
+    static unsigned long counter = 0;
+    return __sync_add_and_fetch(&counter, 1);
+}
+
+Client::Client() : _fd(-1), _id(nextClientId()), _ipAdd(""), _nickname(""), _username(""),
+                   _realname(""), _modes(0), _connexion_password(false),
                    _hasNick(false), _hasUser(false), _registrationDone(false),
-                   _to_deconnect(false), _pass_flag(false) {}
-Client::Client(int fd, const std::string &ipadd) : _fd(fd), _ipAdd(ipadd)
+                   _to_deconnect(false), _quit_sent(false), _pass_flag(false), _flood_clock(0) {}
+Client::Client(int fd, const std::string &ipadd) : _fd(fd), _id(nextClientId()), _ipAdd(ipadd)
 {
     _nickname = "";
     _username = "";
     _realname = "";
-    _modes.clear();
+    _modes = 0;
     _channels.clear();
     _connexion_password = false;
     _hasNick = false;
     _hasUser = false;
     _registrationDone = false;
     _to_deconnect = false;
+    _quit_sent = false;
     _pass_flag = false; // パスワード接続フラグ（PASSコマンドによる）
+    _flood_clock = 0;
 }
 Client::~Client() {}
 
+static ObjectPool<Client> g_client_pool("Client");
+
+void *Client::operator new(size_t size)
+{
+    if (size != sizeof(Client))
+        return ::operator new(size); // 派生クラスは通常のヒープから
+    return g_client_pool.allocate();
+}
+
+void Client::operator delete(void *ptr, size_t size)
+{
+    if (size != sizeof(Client))
+        ::operator delete(ptr);
+    else
+        g_client_pool.deallocate(ptr);
+}
+
+PoolStats Client::poolStats()
+{
+    return g_client_pool.stats();
+}
+
 int Client::getFd() const
 {
     return _fd;
 }
 
+unsigned long Client::getId() const
+{
+    return _id;
+}
+
 void Client::setFd(int newfd) { _fd = newfd; }
 
 void Client::setIpAdd(const std::string &ipadd) { _ipAdd = ipadd; }
 
-std::string Client::getIpAdd() const { return _ipAdd; }
+const std::string &Client::getIpAdd() const { return _ipAdd; }
 
-std::string Client::getNickname() const { return _nickname; }
+const std::string &Client::getNickname() const { return _nickname; }
 void Client::setNickname(const std::string &nick) { _nickname = nick; }
 
-std::string Client::getUsername() const { return _username; }
+const std::string &Client::getUsername() const { return _username; }
 void Client::setUsername(const std::string &user) { _username = user; }
 
-std::string Client::getRealname() const { return _realname; }
+const std::string &Client::getRealname() const { return _realname; }
 void Client::setRealname(const std::string &realname) { _realname = realname; }
 
-const std::set<char> &Client::getModes() const { return _modes; }
-void Client::addMode(char mode)
-{
-    if (_modes.find(mode) == _modes.end()) // モードがまだ追加されていない場合のみ追加
-    {
-        _modes.insert(mode);
-    }
-}
-void Client::removeMode(char mode)
-{
-    // _modes.erase(mode); // C++17 以降、std::string の erase メソッドで文字を削除できます
-    std::set<char>::iterator it = _modes.find(mode);
-    //  it = std::remove(_modes.begin(), _modes.end(), mode);
-    if (it != _modes.end())
-    {
-        _modes.erase(it, _modes.end());
-    }
-}
-bool Client::hasMode(char mode) const
-{
-    return _modes.find(mode) != _modes.end();
-}
+ModeMask Client::getModes() const { return _modes; }
+void Client::addMode(ModeMask mode) { _modes |= mode; }
+void Client::removeMode(ModeMask mode) { _modes &= ~mode; }
+bool Client::hasMode(ModeMask mode) const { return (_modes & mode) != 0; }
 
 bool &Client::getConnexionPassword() { return (_connexion_password); }
 bool &Client::hasNick() { return (_hasNick); }
 bool &Client::hasUser() { return (_hasUser); }
 bool &Client::isRegistrationDone() { return (_registrationDone); }
 bool &Client::getDeconnexionStatus() { return (_to_deconnect); }
+bool &Client::getQuitStatus() { return (_quit_sent); }
 bool &Client::getPassFlag() { return (_pass_flag); } // パスワード接続フラグ（PASSコマンドによる）
+unsigned long &Client::getFloodClock() { return (_flood_clock); }
 
 bool Client::isInChannel(Channel *channel) const
 {
@@ -100,4 +120,4 @@ void Client::removeChannel(Channel *channel)
     _channels.erase(channel->getName());
 }
 
-const std::map<std::string, Channel *> &Client::getChannels() const { return _channels; }
\ No newline at end of file
+const Client::ChannelMap &Client::getChannels() const { return _channels; }
\ No newline at end of file
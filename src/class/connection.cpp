@@ -0,0 +1,69 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   connection.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/13 11:32:08 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/13 11:32:08 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "connection.hpp"
+
+Connection::Connection()
+    : fd(-1), client(NULL), owner(NULL), paused_until(0), ready(false) {}
+
+ConnectionTable::ConnectionTable() : _chunks(NULL), _chunk_count(0), _limit(0) {}
+
+ConnectionTable::~ConnectionTable()
+{
+    for (size_t i = 0; i < _chunk_count; i++)
+        delete[] _chunks[i];
+    delete[] _chunks;
+}
+
+void ConnectionTable::init(size_t max_fds)
+{
+    if (_chunks)
+        return;
+    _chunk_count = (max_fds + CONNTABLE_CHUNK - 1) / CONNTABLE_CHUNK;
+    _chunks = new Connection *[_chunk_count];
+    for (size_t i = 0; i < _chunk_count; i++)
+        _chunks[i] = NULL;
+}
+
+size_t ConnectionTable::limit() const
+{
+    // open() の release と対になる acquire。limit() までのチャンクは find() で読める
+    return __atomic_load_n(&_limit, __ATOMIC_ACQUIRE);
+}
+
+Connection *ConnectionTable::find(int fd) const
+{
+    if (fd < 0 || static_cast<size_t>(fd) / CONNTABLE_CHUNK >= _chunk_count)
+        return NULL;
+    // open() の release と対になる acquire。確保したばかりのチャンクを別スレッドからも正しく読める
+    Connection *chunk = __atomic_load_n(&_chunks[fd / CONNTABLE_CHUNK], __ATOMIC_ACQUIRE);
+    if (!chunk)
+        return NULL;
+    return &chunk[fd % CONNTABLE_CHUNK];
+}
+
+Connection *ConnectionTable::open(int fd)
+{
+    if (fd < 0 || static_cast<size_t>(fd) / CONNTABLE_CHUNK >= _chunk_count)
+        return NULL;
+    size_t index = fd / CONNTABLE_CHUNK;
+    if (!_chunks[index])
+    {
+        Connection *chunk = new Connection[CONNTABLE_CHUNK];
+        for (size_t i = 0; i < CONNTABLE_CHUNK; i++)
+            chunk[i].fd = index * CONNTABLE_CHUNK + i;
+        __atomic_store_n(&_chunks[index], chunk, __ATOMIC_RELEASE);
+        if ((index + 1) * CONNTABLE_CHUNK > _limit)
+            __atomic_store_n(&_limit, (index + 1) * CONNTABLE_CHUNK, __ATOMIC_RELEASE); //-> 他のスレッドは limit() で読む
+    }
+    return &_chunks[index][fd % CONNTABLE_CHUNK];
+}
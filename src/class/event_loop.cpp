@@ -0,0 +1,207 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   event_loop.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/06 14:12:31 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/06 14:12:31 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "event_loop.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+
+EventLoop *EventLoop::create(const std::string &backend)
+{
+#ifdef __linux__
+    if (backend.empty() || backend == "epoll")
+        return new EpollLoop();
+#else
+    if (backend == "epoll")
+        throw std::runtime_error("epoll is not available on this platform");
+#endif
+    if (backend.empty() || backend == "poll")
+        return new PollLoop();
+    throw std::runtime_error("Unknown event backend: " + backend);
+}
+
+/* ------------------------------------------------------------------------ */
+/*  PollLoop                                                                */
+/* ------------------------------------------------------------------------ */
+
+static short toPollEvents(int events)
+{
+    short poll_events = 0;
+    if (events & EVENT_READ)
+        poll_events |= POLLIN;
+    if (events & EVENT_WRITE)
+        poll_events |= POLLOUT;
+    return poll_events;
+}
+
+PollLoop::PollLoop() {}
+PollLoop::~PollLoop() {}
+
+int PollLoop::findSlot(int fd) const
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _slots.size())
+        return -1;
+    return _slots[fd];
+}
+
+void PollLoop::add(int fd, int events)
+{
+    struct pollfd newPoll;
+    newPoll.fd = fd;
+    newPoll.events = toPollEvents(events);
+    newPoll.revents = 0;
+    if (static_cast<size_t>(fd) >= _slots.size())
+        _slots.resize(fd + 1, -1);
+    _slots[fd] = _fds.size();
+    _fds.push_back(newPoll);
+}
+
+bool PollLoop::modify(int fd, int events)
+{
+    int slot = findSlot(fd);
+    if (slot == -1)
+        return false;
+    _fds[slot].events = toPollEvents(events);
+    return true;
+}
+
+void PollLoop::remove(int fd)
+{
+    int slot = findSlot(fd);
+    if (slot == -1)
+        return;
+    // 末尾の要素を空いた位置へ移して pop する（O(1)、他の要素はずらさない）
+    int last = _fds.size() - 1;
+    if (slot != last)
+    {
+        _fds[slot] = _fds[last];
+        _slots[_fds[slot].fd] = slot;
+    }
+    _fds.pop_back();
+    _slots[fd] = -1;
+}
+
+int PollLoop::wait(std::vector<IoEvent> &ready, int timeout_ms)
+{
+    ready.clear();
+    if (poll(&_fds[0], _fds.size(), timeout_ms) == -1)
+        return (errno == EINTR) ? 0 : -1;
+    // poll は全エントリを走査しないと発生したイベントが分からない
+    for (size_t i = 0; i < _fds.size(); i++)
+    {
+        short revents = _fds[i].revents;
+        if (revents == 0)
+            continue;
+        IoEvent ev;
+        ev.fd = _fds[i].fd;
+        ev.events = 0;
+        if (revents & POLLIN)
+            ev.events |= EVENT_READ;
+        if (revents & POLLOUT)
+            ev.events |= EVENT_WRITE;
+        if (revents & (POLLERR | POLLHUP | POLLNVAL))
+            ev.events |= EVENT_ERROR;
+        ready.push_back(ev);
+    }
+    return ready.size();
+}
+
+const char *PollLoop::name() const { return "poll"; }
+
+/* ------------------------------------------------------------------------ */
+/*  EpollLoop                                                               */
+/* ------------------------------------------------------------------------ */
+
+#ifdef __linux__
+
+EpollLoop::EpollLoop() : _registered(0)
+{
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epfd == -1)
+        throw std::runtime_error("epoll_create1() faild");
+    _events.resize(64);
+}
+
+EpollLoop::~EpollLoop()
+{
+    if (_epfd != -1)
+        close(_epfd);
+}
+
+bool EpollLoop::control(int op, int fd, int events)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.data.fd = fd;
+    if (events & EVENT_READ)
+        ev.events |= EPOLLIN | EPOLLRDHUP;
+    if (events & EVENT_WRITE)
+        ev.events |= EPOLLOUT;
+    if (events & EVENT_EDGE)
+        ev.events |= EPOLLET;
+    if (epoll_ctl(_epfd, op, fd, &ev) == -1)
+    {
+        if (errno == ENOENT || errno == EBADF)
+            return false; //-> 切断と入れ違いになっただけなのでサーバーは止めない
+        throw std::runtime_error("epoll_ctl() faild");
+    }
+    return true;
+}
+
+void EpollLoop::add(int fd, int events)
+{
+    if (!control(EPOLL_CTL_ADD, fd, events))
+        throw std::runtime_error("epoll_ctl() faild");
+    __sync_add_and_fetch(&_registered, 1);
+}
+
+bool EpollLoop::modify(int fd, int events)
+{
+    return control(EPOLL_CTL_MOD, fd, events);
+}
+
+void EpollLoop::remove(int fd)
+{
+    // close() 前に呼ぶこと。既に閉じられている場合のエラーは無視する
+    if (epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, NULL) == 0)
+        __sync_sub_and_fetch(&_registered, 1);
+}
+
+int EpollLoop::wait(std::vector<IoEvent> &ready, int timeout_ms)
+{
+    ready.clear();
+    // 登録数が増えたら受け取り領域も倍々で広げる
+    size_t registered = __sync_add_and_fetch(&_registered, 0);
+    while (_events.size() < registered)
+        _events.resize(_events.size() * 2);
+    int n = epoll_wait(_epfd, &_events[0], _events.size(), timeout_ms);
+    if (n == -1)
+        return (errno == EINTR) ? 0 : -1;
+    for (int i = 0; i < n; i++)
+    {
+        IoEvent ev;
+        ev.fd = _events[i].data.fd;
+        ev.events = 0;
+        if (_events[i].events & EPOLLIN)
+            ev.events |= EVENT_READ;
+        if (_events[i].events & EPOLLOUT)
+            ev.events |= EVENT_WRITE;
+        if (_events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+            ev.events |= EVENT_ERROR;
+        ready.push_back(ev);
+    }
+    return n;
+}
+
+const char *EpollLoop::name() const { return "epoll"; }
+
+#endif
@@ -0,0 +1,226 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   line_buffer.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/08 10:21:05 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/08 10:21:05 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "line_buffer.hpp"
+
+RecvBufferPool::RecvBufferPool() : _in_use(0), _cached_bytes(0) {}
+
+RecvBufferPool::~RecvBufferPool()
+{
+    for (size_t i = 0; i < RECVPOOL_CLASSES; i++)
+    {
+        for (size_t j = 0; j < _free[i].size(); j++)
+            delete[] _free[i][j];
+    }
+}
+
+char *RecvBufferPool::acquire(size_t min_size, size_t &capacity)
+{
+    capacity = LINEBUF_READ_CHUNK;
+    size_t cls = 0;
+    while (capacity < min_size)
+    {
+        capacity *= 2;
+        cls++;
+    }
+    __atomic_store_n(&_in_use, _in_use + 1, __ATOMIC_RELAXED);
+    if (cls < RECVPOOL_CLASSES && !_free[cls].empty())
+    {
+        char *buf = _free[cls].back();
+        _free[cls].pop_back();
+        __atomic_store_n(&_cached_bytes, _cached_bytes - capacity, __ATOMIC_RELAXED);
+        return buf;
+    }
+    return new char[capacity];
+}
+
+void RecvBufferPool::release(char *buf, size_t capacity)
+{
+    if (!buf)
+        return;
+    __atomic_store_n(&_in_use, _in_use - 1, __ATOMIC_RELAXED);
+    size_t cls = 0;
+    while ((size_t)LINEBUF_READ_CHUNK << cls < capacity)
+        cls++;
+    if (cls < RECVPOOL_CLASSES && _free[cls].size() < RECVPOOL_KEEP)
+    {
+        _free[cls].push_back(buf);
+        __atomic_store_n(&_cached_bytes, _cached_bytes + capacity, __ATOMIC_RELAXED);
+        return;
+    }
+    delete[] buf;
+}
+
+// 書くのは担当スレッドだけなので、統計値は読み書きを __atomic にするだけで他スレッドから読める
+size_t RecvBufferPool::inUse() const
+{
+    return __atomic_load_n(&_in_use, __ATOMIC_RELAXED);
+}
+
+size_t RecvBufferPool::cachedBytes() const
+{
+    return __atomic_load_n(&_cached_bytes, __ATOMIC_RELAXED);
+}
+
+LineBuffer::LineBuffer(RecvBufferPool *pool)
+    : _pool(pool), _buf(NULL), _capacity(0), _start(0), _end(0), _scan(0), _discarding(false) {}
+
+LineBuffer::LineBuffer(const LineBuffer &other)
+    : _pool(other._pool), _buf(NULL), _capacity(0), _start(0), _end(0), _scan(0), _discarding(false)
+{
+    *this = other;
+}
+
+void LineBuffer::setPool(RecvBufferPool *pool)
+{
+    if (_pool == pool)
+        return;
+    clear(); //-> 元のプールに返してから切り替える
+    _pool = pool;
+}
+
+char *LineBuffer::allocate(size_t min_size, size_t &capacity)
+{
+    if (_pool)
+        return _pool->acquire(min_size, capacity);
+    capacity = LINEBUF_READ_CHUNK;
+    while (capacity < min_size)
+        capacity *= 2;
+    return new char[capacity];
+}
+
+void LineBuffer::deallocate(char *buf, size_t capacity)
+{
+    if (_pool)
+        _pool->release(buf, capacity);
+    else
+        delete[] buf;
+}
+
+LineBuffer &LineBuffer::operator=(const LineBuffer &other)
+{
+    if (this == &other)
+        return *this;
+    clear();
+    size_t pending = other._end - other._start;
+    if (pending > 0)
+    {
+        prepare(pending);
+        memcpy(_buf, other._buf + other._start, pending);
+        _end = pending;
+        _scan = other._scan - other._start;
+    }
+    _discarding = other._discarding;
+    return *this;
+}
+
+LineBuffer::~LineBuffer()
+{
+    deallocate(_buf, _capacity);
+}
+
+char *LineBuffer::prepare(size_t min_space)
+{
+    if (_capacity - _end >= min_space)
+        return _buf + _end;
+
+    // 処理済みの先頭部分を詰める
+    if (_start > 0)
+    {
+        memmove(_buf, _buf + _start, _end - _start);
+        _end -= _start;
+        _scan -= _start;
+        _start = 0;
+    }
+    if (_capacity - _end < min_space)
+    {
+        size_t capacity;
+        char *buf = allocate(_end + min_space, capacity);
+        if (_end > 0)
+            memcpy(buf, _buf, _end);
+        deallocate(_buf, _capacity);
+        _buf = buf;
+        _capacity = capacity;
+    }
+    return _buf + _end;
+}
+
+size_t LineBuffer::writable() const
+{
+    return _capacity - _end;
+}
+
+void LineBuffer::commit(size_t n)
+{
+    _end += n;
+    // 改行が無いまま上限を超えた行は届いた時点で捨て、次の改行まで読み飛ばす
+    // （行の処理が次の周回に回されても、受信バッファが上限を超えて伸びないように）
+    if ((_discarding || _end - _start > LINEBUF_MAX_LINE) && !memchr(_buf + _scan, '\n', _end - _scan))
+    {
+        _start = _end = _scan = 0;
+        _discarding = true;
+    }
+}
+
+bool LineBuffer::nextLine(StringView &line)
+{
+    while (_scan < _end)
+    {
+        const char *nl = static_cast<const char *>(memchr(_buf + _scan, '\n', _end - _scan));
+        if (!nl)
+        {
+            _scan = _end; //-> ここまでは改行なし。次回は続きから探す
+            return false;
+        }
+        size_t pos = nl - _buf;
+        // 長すぎる行（読み捨て中の行の残りも）は渡さずに捨てる
+        if (_discarding || pos - _start > LINEBUF_MAX_LINE)
+        {
+            _discarding = false;
+            _start = _scan = pos + 1;
+            continue;
+        }
+        line.data = _buf + _start;
+        line.size = pos - _start;
+        if (line.size > 0 && line.data[line.size - 1] == '\r')
+            line.size--;
+        _start = _scan = pos + 1;
+        if (_start == _end)
+            _start = _end = _scan = 0; //-> 空になったら先頭から使い直す（データは次の prepare まで残る）
+        return true;
+    }
+    return false;
+}
+
+size_t LineBuffer::size() const
+{
+    return _end - _start;
+}
+
+void LineBuffer::release()
+{
+    if (_start != _end)
+        return; //-> 途中までの行が残っている
+    deallocate(_buf, _capacity);
+    _buf = NULL;
+    _capacity = 0;
+    _start = _end = _scan = 0;
+}
+
+void LineBuffer::clear()
+{
+    deallocate(_buf, _capacity);
+    _buf = NULL;
+    _capacity = 0;
+    _start = _end = _scan = 0;
+    _discarding = false;
+}
@@ -0,0 +1,239 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   logger.cpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/16 10:24:37 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/16 10:24:37 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "logger.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+
+Logger::Slot *Logger::_ring = NULL;
+size_t Logger::_head = 0;
+size_t Logger::_tail = 0;
+int Logger::_level = LOG_LEVEL_INFO;
+bool Logger::_running = false;
+pthread_t Logger::_thread;
+size_t Logger::_dropped = 0;
+
+static const char *levelName(LogLevel level)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_DEBUG:
+        return "DEBUG";
+    case LOG_LEVEL_INFO:
+        return "INFO ";
+    case LOG_LEVEL_WARN:
+        return "WARN ";
+    default:
+        return "ERROR";
+    }
+}
+
+static unsigned long wallClockMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<unsigned long>(ts.tv_sec) * 1000000UL + ts.tv_nsec / 1000;
+}
+
+bool Logger::parseLevel(const std::string &name, LogLevel &level)
+{
+    if (name == "debug")
+        level = LOG_LEVEL_DEBUG;
+    else if (name == "info")
+        level = LOG_LEVEL_INFO;
+    else if (name == "warn")
+        level = LOG_LEVEL_WARN;
+    else if (name == "error")
+        level = LOG_LEVEL_ERROR;
+    else
+        return false;
+    return true;
+}
+
+void Logger::setLevel(LogLevel level)
+{
+    __atomic_store_n(&_level, static_cast<int>(level), __ATOMIC_RELAXED);
+}
+
+void Logger::start(LogLevel level)
+{
+    setLevel(level);
+    if (_running)
+        return;
+    _ring = new Slot[LOG_RING_SIZE];
+    for (size_t i = 0; i < LOG_RING_SIZE; i++)
+        _ring[i].seq = i;
+    _head = 0;
+    _tail = 0;
+    __atomic_store_n(&_running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&_thread, NULL, &Logger::writerMain, NULL) != 0)
+    {
+        _running = false;
+        delete[] _ring;
+        _ring = NULL;
+        throw(std::runtime_error("pthread_create() faild for logger"));
+    }
+}
+
+// 他のスレッドが止まってから呼ぶ（以降の write はその場で書き出す）
+void Logger::stop()
+{
+    if (!_running)
+        return;
+    __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+    pthread_join(_thread, NULL);
+    std::string batch;
+    drain(batch);
+    flush(batch);
+    delete[] _ring;
+    _ring = NULL;
+}
+
+// 書き込み側（どのスレッドからでもよい）
+// 空きスロットを CAS で 1 つ確保してから中身を書き、最後に通し番号を進めて読み出し側に渡す
+void Logger::write(LogLevel level, const char *text, size_t size)
+{
+    if (size > LOG_LINE_MAX)
+        size = LOG_LINE_MAX;
+    if (!__atomic_load_n(&_running, __ATOMIC_ACQUIRE))
+    {
+        std::string line;
+        format(line, wallClockMicros(), level, text, size);
+        flush(line);
+        return;
+    }
+    size_t pos = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+    Slot *slot;
+    while (true)
+    {
+        slot = &_ring[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        long diff = static_cast<long>(seq) - static_cast<long>(pos);
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+        {
+            __atomic_fetch_add(&_dropped, 1, __ATOMIC_RELAXED); //-> 一杯。イベントループを待たせない
+            return;
+        }
+        else
+            pos = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+    }
+    slot->time = wallClockMicros();
+    slot->level = level;
+    slot->size = size;
+    memcpy(slot->text, text, size);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+void *Logger::writerMain(void *arg)
+{
+    (void)arg;
+    // シグナルはメインスレッドで受け取る
+    sigset_t blocked;
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_BLOCK, &blocked, NULL);
+
+    std::string batch;
+    batch.reserve(LOG_BATCH_BYTES + LOG_LINE_MAX * 2);
+    while (__atomic_load_n(&_running, __ATOMIC_ACQUIRE))
+    {
+        drain(batch);
+        flush(batch);
+        usleep(LOG_FLUSH_INTERVAL);
+    }
+    return NULL;
+}
+
+// 積まれた行を batch に整形する。LOG_BATCH_BYTES を超えたら途中でも書き出す
+void Logger::drain(std::string &batch)
+{
+    while (true)
+    {
+        Slot &slot = _ring[_tail & (LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE) != _tail + 1)
+            break; //-> 空（または書き込み中）
+        format(batch, slot.time, slot.level, slot.text, slot.size);
+        __atomic_store_n(&slot.seq, _tail + LOG_RING_SIZE, __ATOMIC_RELEASE); //-> 1 周後の書き込み側に返す
+        _tail++;
+        if (batch.size() >= LOG_BATCH_BYTES)
+            flush(batch);
+    }
+    size_t dropped = __atomic_exchange_n(&_dropped, 0, __ATOMIC_RELAXED);
+    if (dropped)
+    {
+        char text[64];
+        int len = snprintf(text, sizeof(text), "log buffer full, %lu lines dropped", static_cast<unsigned long>(dropped));
+        format(batch, wallClockMicros(), LOG_LEVEL_WARN, text, len);
+    }
+}
+
+// "HH:MM:SS.mmm LEVEL text\n"
+void Logger::format(std::string &out, unsigned long time, LogLevel level, const char *text, size_t size)
+{
+    time_t seconds = static_cast<time_t>(time / 1000000UL);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    char prefix[32];
+    int len = snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03lu %s ", local.tm_hour, local.tm_min,
+                       local.tm_sec, (time / 1000UL) % 1000UL, levelName(level));
+    out.append(prefix, len);
+    out.append(text, size);
+    out += '\n';
+}
+
+// 標準出力にまとめて書き出す（途中までしか書けなかった場合は残りを書き直す）
+void Logger::flush(std::string &batch)
+{
+    size_t done = 0;
+    while (done < batch.size())
+    {
+        ssize_t n = ::write(STDOUT_FILENO, batch.data() + done, batch.size() - done);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break; //-> 書けなければ捨てる（ログのためにサーバーを止めない）
+        done += n;
+    }
+    batch.clear();
+}
+
+// LogLine
+
+LogLine &LogLine::append(const char *data, size_t size)
+{
+    if (size > LOG_LINE_MAX - _size)
+        size = LOG_LINE_MAX - _size;
+    memcpy(_buf + _size, data, size);
+    _size += size;
+    return *this;
+}
+
+LogLine &LogLine::operator<<(long n)
+{
+    char digits[24];
+    int len = snprintf(digits, sizeof(digits), "%ld", n);
+    return append(digits, len);
+}
+
+LogLine &LogLine::operator<<(unsigned long n)
+{
+    char digits[24];
+    int len = snprintf(digits, sizeof(digits), "%lu", n);
+    return append(digits, len);
+}
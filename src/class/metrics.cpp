@@ -0,0 +1,282 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   metrics.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/15 15:32:06 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/15 15:32:06 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "metrics.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <sys/stat.h> //-> for stat()
+#include <sys/un.h>   //-> for sockaddr_un
+
+// Histogram
+
+Histogram::Histogram() : _count(0), _sum(0)
+{
+    memset(_counts, 0, sizeof(_counts));
+}
+
+// 16 未満はそのまま、それ以上は (最上位ビットの位置, 続く 4 ビット) で区間を決める
+size_t Histogram::bucketOf(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_COUNT)
+        return value;
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent >= HISTOGRAM_MAX_BITS)
+        return HISTOGRAM_BUCKETS - 1;
+    size_t sub = (value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_COUNT - 1);
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT + sub;
+}
+
+// 区間に入る最大の値
+static uint64_t bucketUpper(size_t bucket)
+{
+    size_t group = bucket / HISTOGRAM_SUB_COUNT;
+    size_t sub = bucket % HISTOGRAM_SUB_COUNT;
+    if (group == 0)
+        return sub;
+    int shift = group - 1;
+    return ((static_cast<uint64_t>(HISTOGRAM_SUB_COUNT + sub) << shift) + (static_cast<uint64_t>(1) << shift)) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+    metricsAdd(_counts[bucketOf(value)], 1);
+    metricsAdd(_count, 1);
+    metricsAdd(_sum, value);
+}
+
+void Histogram::load(Histogram &total) const
+{
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        total._counts[i] += __atomic_load_n(&_counts[i], __ATOMIC_RELAXED);
+    total._count += __atomic_load_n(&_count, __ATOMIC_RELAXED);
+    total._sum += __atomic_load_n(&_sum, __ATOMIC_RELAXED);
+}
+
+uint64_t Histogram::countAtMost(uint64_t value) const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS && bucketUpper(i) <= value; i++)
+        total += _counts[i];
+    return total;
+}
+
+// MetricsWriter
+
+MetricsWriter::MetricsWriter()
+{
+    _out.precision(9);
+}
+
+void MetricsWriter::header(const char *name, const char *type, const char *help)
+{
+    _out << "# HELP " << name << " " << help << "\n";
+    _out << "# TYPE " << name << " " << type << "\n";
+}
+
+void MetricsWriter::value(const char *name, const std::string &labels, double value)
+{
+    _out << name;
+    if (!labels.empty())
+        _out << "{" << labels << "}";
+    _out << " " << value << "\n";
+}
+
+void MetricsWriter::value(const char *name, const std::string &labels, uint64_t value)
+{
+    _out << name;
+    if (!labels.empty())
+        _out << "{" << labels << "}";
+    _out << " " << value << "\n";
+}
+
+void MetricsWriter::histogram(const char *name, const std::string &labels, const Histogram &histogram,
+                              const uint64_t *bounds, size_t bound_count, double scale)
+{
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    for (size_t i = 0; i < bound_count; i++)
+    {
+        _out << name << "_bucket{" << prefix << "le=\"" << bounds[i] * scale << "\"} "
+             << histogram.countAtMost(bounds[i]) << "\n";
+    }
+    _out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << histogram.count() << "\n";
+    std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+    _out << name << "_sum" << suffix << " " << histogram.sum() * scale << "\n";
+    _out << name << "_count" << suffix << " " << histogram.count() << "\n";
+}
+
+// MetricsEndpoint
+
+MetricsEndpoint::MetricsEndpoint() : _listen_fd(-1), _loop(NULL) {}
+
+MetricsEndpoint::~MetricsEndpoint()
+{
+    close();
+}
+
+void MetricsEndpoint::open(EventLoop *loop, int port, const std::string &unix_path)
+{
+    _loop = loop;
+    if (!unix_path.empty())
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (unix_path.size() >= sizeof(addr.sun_path))
+            throw(std::runtime_error("metrics socket path too long"));
+        memcpy(addr.sun_path, unix_path.c_str(), unix_path.size());
+        // 前回の起動で残ったソケットだけは消してよい（通常のファイルは消さない）
+        struct stat st;
+        if (stat(unix_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+            unlink(unix_path.c_str());
+        _listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_listen_fd == -1)
+            throw(std::runtime_error("faild to create metrics socket"));
+        if (bind(_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+            throw(std::runtime_error("faild to bind metrics socket"));
+        _unix_path = unix_path;
+    }
+    else
+    {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); //-> ローカルからだけ読める
+        _listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listen_fd == -1)
+            throw(std::runtime_error("faild to create metrics socket"));
+        int en = 1;
+        if (setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &en, sizeof(en)) == -1)
+            throw(std::runtime_error("faild to set option (SO_REUSEADDR) on metrics socket"));
+        if (bind(_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+            throw(std::runtime_error("faild to bind metrics socket"));
+    }
+    if (fcntl(_listen_fd, F_SETFL, O_NONBLOCK) == -1)
+        throw(std::runtime_error("faild to set option (O_NONBLOCK) on metrics socket"));
+    if (listen(_listen_fd, METRICS_MAX_CLIENTS) == -1)
+        throw(std::runtime_error("listen() faild on metrics socket"));
+    _loop->add(_listen_fd, EVENT_READ);
+}
+
+void MetricsEndpoint::close()
+{
+    while (!_requests.empty())
+        closeRequest(_requests.begin()->first);
+    if (_listen_fd != -1)
+    {
+        if (_loop)
+            _loop->remove(_listen_fd);
+        ::close(_listen_fd);
+        _listen_fd = -1;
+    }
+    if (!_unix_path.empty())
+        unlink(_unix_path.c_str());
+    _unix_path.clear();
+    _loop = NULL;
+}
+
+void MetricsEndpoint::closeRequest(int fd)
+{
+    _loop->remove(fd);
+    ::close(fd);
+    _requests.erase(fd);
+}
+
+bool MetricsEndpoint::handle(int fd, int events, std::string &path)
+{
+    if (fd == _listen_fd)
+    {
+        int incofd;
+        while ((incofd = accept(_listen_fd, NULL, NULL)) != -1)
+        {
+            if (_requests.size() >= METRICS_MAX_CLIENTS || fcntl(incofd, F_SETFL, O_NONBLOCK) == -1)
+            {
+                ::close(incofd);
+                continue;
+            }
+            _requests[incofd] = Request();
+            _loop->add(incofd, EVENT_READ);
+        }
+        return false;
+    }
+
+    std::map<int, Request>::iterator it = _requests.find(fd);
+    if (it == _requests.end())
+        return false;
+    Request &request = it->second;
+    if (!request.output.empty())
+    {
+        if (events & (EVENT_WRITE | EVENT_ERROR))
+            flush(fd, request);
+        return false;
+    }
+
+    char buf[1024];
+    ssize_t bytes;
+    while ((bytes = recv(fd, buf, sizeof(buf), 0)) > 0)
+        request.data.append(buf, bytes);
+    if (bytes == 0 || (bytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK) ||
+        request.data.size() > METRICS_MAX_REQUEST)
+    {
+        closeRequest(fd);
+        return false;
+    }
+    // ヘッダーの終わりまで届いてから答える（本文は読まない）
+    if (request.data.find("\r\n\r\n") == std::string::npos && request.data.find("\n\n") == std::string::npos)
+        return false;
+    // "GET /metrics HTTP/1.1" の形だけ受け付ける
+    size_t method_end = request.data.find(' ');
+    size_t path_end = request.data.find_first_of(" \r\n", method_end + 1);
+    if (method_end == std::string::npos || path_end == std::string::npos ||
+        request.data.compare(0, method_end, "GET") != 0)
+    {
+        respond(fd, 405, "method not allowed\n");
+        return false;
+    }
+    path = request.data.substr(method_end + 1, path_end - method_end - 1);
+    return true;
+}
+
+void MetricsEndpoint::respond(int fd, int status, const std::string &body)
+{
+    std::map<int, Request>::iterator it = _requests.find(fd);
+    if (it == _requests.end())
+        return;
+    const char *reason = (status == 200) ? "OK" : (status == 404) ? "Not Found" : "Method Not Allowed";
+    std::ostringstream out;
+    out << "HTTP/1.0 " << status << " " << reason << "\r\n"
+        << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << body;
+    it->second.output = out.str();
+    flush(fd, it->second);
+}
+
+// 送れるだけ送り、残りは書き込み可能になってから送る。送り終えたら閉じる
+void MetricsEndpoint::flush(int fd, Request &request)
+{
+    while (request.sent < request.output.size())
+    {
+        ssize_t sent = send(fd, request.output.data() + request.sent, request.output.size() - request.sent, 0);
+        if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            _loop->modify(fd, EVENT_WRITE);
+            return;
+        }
+        if (sent <= 0)
+            break;
+        request.sent += sent;
+    }
+    closeRequest(fd);
+}
@@ -0,0 +1,132 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   nick_index.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/09 11:02:14 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/09 11:02:14 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "nick_index.hpp"
+
+#define NICKINDEX_MIN_CAPACITY 64
+
+bool ircCaseEquals(const std::string &a, const std::string &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (ircToLower(a[i]) != ircToLower(b[i]))
+            return false;
+    }
+    return true;
+}
+
+NickIndex::NickIndex() : _slots(NICKINDEX_MIN_CAPACITY), _size(0)
+{
+    for (size_t i = 0; i < _slots.size(); i++)
+        _slots[i].client = NULL;
+}
+
+// FNV-1a（小文字化しながら計算するのでコピー不要）
+size_t NickIndex::hash(const std::string &nick)
+{
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < nick.size(); i++)
+    {
+        h ^= static_cast<unsigned char>(ircToLower(nick[i]));
+        h *= 16777619u;
+    }
+    return h;
+}
+
+size_t NickIndex::findSlot(const std::string &nick) const
+{
+    size_t mask = _slots.size() - 1;
+    size_t i = hash(nick) & mask;
+    while (_slots[i].client && !ircCaseEquals(_slots[i].key, nick))
+        i = (i + 1) & mask;
+    return i;
+}
+
+void NickIndex::rehash(size_t capacity)
+{
+    std::vector<Slot> old(capacity);
+    for (size_t i = 0; i < old.size(); i++)
+        old[i].client = NULL;
+    old.swap(_slots);
+    for (size_t i = 0; i < old.size(); i++)
+    {
+        if (!old[i].client)
+            continue;
+        Slot &slot = _slots[findSlot(old[i].key)];
+        slot.key.swap(old[i].key);
+        slot.client = old[i].client;
+    }
+}
+
+Client *NickIndex::find(const std::string &nick) const
+{
+    return _slots[findSlot(nick)].client;
+}
+
+bool NickIndex::insert(const std::string &nick, Client *client)
+{
+    // 負荷率を 1/2 以下に保つ
+    if ((_size + 1) * 2 > _slots.size())
+        rehash(_slots.size() * 2);
+    Slot &slot = _slots[findSlot(nick)];
+    if (slot.client)
+        return slot.client == client;
+    slot.key.resize(nick.size());
+    for (size_t i = 0; i < nick.size(); i++)
+        slot.key[i] = ircToLower(nick[i]);
+    slot.client = client;
+    _size++;
+    return true;
+}
+
+void NickIndex::erase(const std::string &nick, Client *client)
+{
+    size_t mask = _slots.size() - 1;
+    size_t i = findSlot(nick);
+    if (_slots[i].client != client || !client)
+        return;
+    _slots[i].client = NULL;
+    _slots[i].key.clear();
+    _size--;
+    // 後続の要素のうち、空いた位置より前に本来の位置があるものを詰める
+    size_t j = i;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (!_slots[j].client)
+            break;
+        size_t home = hash(_slots[j].key) & mask;
+        // home が (i, j] の範囲に無ければ i に移せる
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        _slots[i].key.swap(_slots[j].key);
+        _slots[i].client = _slots[j].client;
+        _slots[j].client = NULL;
+        _slots[j].key.clear();
+        i = j;
+    }
+}
+
+size_t NickIndex::size() const
+{
+    return _size;
+}
+
+void NickIndex::clear()
+{
+    std::vector<Slot>(NICKINDEX_MIN_CAPACITY).swap(_slots);
+    for (size_t i = 0; i < _slots.size(); i++)
+        _slots[i].client = NULL;
+    _size = 0;
+}
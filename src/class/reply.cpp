@@ -0,0 +1,51 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   reply.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/11 16:45:02 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/11 16:45:02 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "reply.hpp"
+
+Reply &Reply::append(const char *data, size_t size)
+{
+    if (_overflow.empty() && _size + size <= REPLY_INLINE_SIZE)
+    {
+        memcpy(_inline + _size, data, size);
+        _size += size;
+        return *this;
+    }
+    // 長い行は以降 std::string 側で組み立てる
+    if (_overflow.empty())
+    {
+        _overflow.reserve(_size + size);
+        _overflow.assign(_inline, _size);
+    }
+    _overflow.append(data, size);
+    _size += size;
+    return *this;
+}
+
+Reply &Reply::format(const ReplyTemplate &tpl, const std::string &nick)
+{
+    append(tpl.head.data(), tpl.head.size());
+    append(nick.data(), nick.size());
+    return append(tpl.tail.data(), tpl.tail.size());
+}
+
+ReplyTemplate::ReplyTemplate(const std::string &line)
+{
+    size_t marker = line.find(REPLY_NICK_MARKER);
+    if (marker == std::string::npos)
+    {
+        head = line;
+        return;
+    }
+    head = line.substr(0, marker);
+    tail = line.substr(marker + 1);
+}
@@ -0,0 +1,263 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   send_queue.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/07 11:03:48 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/07 11:03:48 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "send_queue.hpp"
+
+#include <cerrno>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+#define SENDQ_IOV_BATCH (IOV_MAX < 1024 ? IOV_MAX : 1024) //-> 1 回の writev でまとめるセグメント数
+#define SENDQ_CHUNK_SIZE 4096                              //-> 個別セグメントのチャンクサイズ
+
+/* ------------------------------------------------------------------------ */
+/*  SharedMessage                                                           */
+/* ------------------------------------------------------------------------ */
+
+SharedMessage::SharedMessage(const std::string &data) : _data(data), _refs(1) {}
+SharedMessage::~SharedMessage() {}
+
+SharedMessage *SharedMessage::create(const std::string &data)
+{
+    return new SharedMessage(data);
+}
+
+void SharedMessage::retain()
+{
+    __sync_add_and_fetch(&_refs, 1);
+}
+
+void SharedMessage::release()
+{
+    if (__sync_sub_and_fetch(&_refs, 1) == 0)
+        delete this;
+}
+
+const char *SharedMessage::data() const { return _data.data(); }
+size_t SharedMessage::size() const { return _data.size(); }
+
+/* ------------------------------------------------------------------------ */
+/*  SendQueue                                                               */
+/* ------------------------------------------------------------------------ */
+
+SendQueue::SendQueue() : _head(NULL), _tail(NULL), _bytes(0), _messages(0) {}
+
+SendQueue::SendQueue(const SendQueue &other) : _head(NULL), _tail(NULL), _bytes(0), _messages(0)
+{
+    *this = other;
+}
+
+SendQueue &SendQueue::operator=(const SendQueue &other)
+{
+    if (this == &other)
+        return *this;
+    clear();
+    for (Segment *seg = other._head; seg; seg = seg->next)
+    {
+        Segment *copy = newSegment();
+        *copy = *seg;
+        copy->next = NULL;
+        if (seg->msg)
+            copy->msg->retain();
+        else
+        {
+            copy->chunk = new char[SENDQ_CHUNK_SIZE];
+            memcpy(copy->chunk, seg->chunk, seg->end);
+        }
+        append(copy);
+        _bytes += copy->end - copy->begin;
+        _messages += copy->count;
+    }
+    return *this;
+}
+
+SendQueue::~SendQueue()
+{
+    clear();
+}
+
+SendQueue::Segment *SendQueue::newSegment()
+{
+    Segment *seg = new Segment;
+    seg->msg = NULL;
+    seg->chunk = NULL;
+    seg->begin = 0;
+    seg->end = 0;
+    seg->count = 0;
+    seg->next = NULL;
+    return seg;
+}
+
+void SendQueue::append(Segment *seg)
+{
+    if (_tail)
+        _tail->next = seg;
+    else
+        _head = seg;
+    _tail = seg;
+}
+
+void SendQueue::popFront()
+{
+    Segment *seg = _head;
+    _head = seg->next;
+    if (!_head)
+        _tail = NULL;
+    _messages -= seg->count;
+    if (seg->msg)
+        seg->msg->release();
+    delete[] seg->chunk;
+    delete seg;
+}
+
+Mutex &SendQueue::mutex() const { return _mutex; }
+
+const char *SendQueue::segmentData(const Segment *seg)
+{
+    return seg->msg ? seg->msg->data() : seg->chunk;
+}
+
+void SendQueue::push(SharedMessage *msg)
+{
+    if (msg->size() == 0)
+        return;
+    Segment *seg = newSegment();
+    seg->msg = msg;
+    seg->end = msg->size();
+    seg->count = 1;
+    msg->retain();
+    append(seg);
+    _bytes += msg->size();
+    _messages++;
+}
+
+void SendQueue::push(const std::string &message)
+{
+    push(message.data(), message.size());
+}
+
+void SendQueue::push(const char *data, size_t size)
+{
+    if (size == 0)
+        return;
+    // チャンクに収まらない長い行は共有メッセージとして 1 セグメントにする
+    if (size > SENDQ_CHUNK_SIZE)
+    {
+        SharedMessage *shared = SharedMessage::create(std::string(data, size));
+        push(shared);
+        shared->release();
+        return;
+    }
+    if (!_tail || _tail->msg || SENDQ_CHUNK_SIZE - _tail->end < size)
+    {
+        Segment *seg = newSegment();
+        seg->chunk = new char[SENDQ_CHUNK_SIZE];
+        append(seg);
+    }
+    memcpy(_tail->chunk + _tail->end, data, size);
+    _tail->end += size;
+    _tail->count++;
+    _bytes += size;
+    _messages++;
+}
+
+bool SendQueue::empty() const
+{
+    return _head == NULL;
+}
+
+size_t SendQueue::bytes() const
+{
+    return _bytes;
+}
+
+size_t SendQueue::messages() const
+{
+    return _messages;
+}
+
+void SendQueue::clear()
+{
+    while (_head)
+        popFront();
+    _bytes = 0;
+    _messages = 0;
+}
+
+// 先頭行が途中まで送られていたら、その残りだけは残す
+// （続けて送る行が相手から見て途中の行につながってしまわないように）
+// 1 行が複数のセグメントにまたがることはないので、残りは先頭セグメントの中にある
+size_t SendQueue::dropUnsent()
+{
+    std::string rest;
+    if (_head && _head->begin > 0)
+    {
+        const char *data = segmentData(_head);
+        if (data[_head->begin - 1] != '\n')
+        {
+            const char *from = data + _head->begin;
+            const char *eol = static_cast<const char *>(memchr(from, '\n', _head->end - _head->begin));
+            rest.assign(from, eol ? eol + 1 : data + _head->end);
+        }
+    }
+    size_t dropped = _bytes - rest.size();
+    clear();
+    push(rest);
+    return dropped;
+}
+
+ssize_t SendQueue::flush(int fd)
+{
+    ssize_t total = 0;
+    while (_head)
+    {
+        // 先頭から最大 IOV_MAX セグメントを iovec に並べる
+        struct iovec iov[SENDQ_IOV_BATCH];
+        int count = 0;
+        size_t requested = 0;
+        for (Segment *seg = _head; seg && count < SENDQ_IOV_BATCH; seg = seg->next, ++count)
+        {
+            iov[count].iov_base = const_cast<char *>(segmentData(seg) + seg->begin);
+            iov[count].iov_len = seg->end - seg->begin;
+            requested += iov[count].iov_len;
+        }
+
+        ssize_t sent = writev(fd, iov, count);
+        if (sent == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break; //-> カーネルの送信バッファが満杯
+            return -1;
+        }
+        total += sent;
+        _bytes -= sent;
+
+        // 送信できた分だけ読み出しカーソルを進め、送り切ったセグメントを外す
+        size_t left = sent;
+        while (left > 0)
+        {
+            size_t remain = _head->end - _head->begin;
+            if (left < remain)
+            {
+                _head->begin += left;
+                break;
+            }
+            left -= remain;
+            popFront();
+        }
+        if (static_cast<size_t>(sent) < requested)
+            break; //-> 一部しか送れなかった = バッファが満杯
+    }
+    return total;
+}
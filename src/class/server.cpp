@@ -16,33 +16,48 @@
 #include "server.hpp"
 #include "color.hpp"
 #include "command.hpp"
+#include "numerical_replies.hpp"
 
-bool Server::_signal = false;
+#include <cerrno>
+#include <sys/resource.h> //-> for getrlimit()
+#include <netinet/tcp.h>  //-> for TCP_NODELAY
 
-Server::Server() : _port(-1), _serSocketFd(-1)
+#define ACCEPT_BATCH_MAX 256 //-> 1 回の通知で受け付ける最大の接続数
+
+volatile sig_atomic_t Server::_signal = 0;
+
+Server::Server() : _port(-1), _serSocketFd(-1), _next_worker(0), _sendq_dropped_bytes(0), _sendq_disconnects(0),
+				   _accept_window(0), _accept_count(0), _accept_throttled(0), _welcome(NULL), _client_count(0)
 {
 	// コンストラクタの初期化リストでメンバ変数を初期化
-	_signal = false; // シグナルフラグを初期化
+	__atomic_store_n(&_signal, 0, __ATOMIC_RELAXED); // シグナルフラグを初期化
 	_password = "";	 // パスワードを空に初期化
 	// _operators.clear(); // サーバーオペレーターのベクターをクリア
-	_fds.clear();		   // pollfdのベクターを空に初期化
-	_clients.clear();	   // クライアントのマップを空に初期化
-	_channels.clear();	   // チャンネルのマップを空に初期化
-	_send_buffers.clear(); // 送信バッファを空に初期化
-	_recv_buffers.clear(); // 受信バッファを空に初期化
+	_workers.clear();  // イベントループのスレッドを空に初期化
+	_channels.clear(); // チャンネルのマップを空に初期化
 }
 Server::~Server() {}
 
-std::map<int, Client *> Server::getClients()
+size_t Server::getClientCount() const
 {
-	return _clients;
+	return _client_count;
 }
 
-std::map<std::string, Channel *> Server::getChannels()
+int Server::getFdLimit() const
+{
+	return static_cast<int>(_connections.limit());
+}
+
+const std::map<std::string, Channel *> &Server::getChannels() const
 {
 	return _channels;
 }
 
+size_t Server::getChannelCount() const
+{
+	return _channels.size();
+}
+
 // ポート番号取得
 int Server::getPort() const { return _port; }
 
@@ -68,69 +83,134 @@ Client *Server::getClient(int fd)
 	// 		return _clients[i];
 	// 	}
 	// }
-	std::map<int, Client *>::iterator it = _clients.find(fd);
-	if (it != _clients.end())
-	{
-		return it->second; // クライアントが見つかった場合はそのポインタを返す
-	}
-	return NULL;
+	Connection *conn = _connections.find(fd); //-> 木をたどらず添字 1 回で引く
+	return conn ? conn->client : NULL;
+}
+
+// worker が担当している接続を返す（担当スレッドから _registry_lock なしで呼べる）
+// owner の acquire で、前に使っていたスレッドが片付けた受信バッファなどを確実に読める
+Connection *Server::getConnection(Worker &worker, int fd)
+{
+	Connection *conn = _connections.find(fd);
+	if (!conn || __atomic_load_n(&conn->owner, __ATOMIC_ACQUIRE) != &worker)
+		return NULL;
+	return conn;
 }
 
 // クライアントのニックネームでクライアントを取得
 Client *Server::getClientByNickname(const std::string &nickname)
 {
-	for (std::map<int, Client *>::iterator it = _clients.begin(); it != _clients.end(); ++it)
-	{
-		if (it->second->getNickname() == nickname)
-		{
-			return it->second; // ニックネームが一致するクライアントを返す
-		}
-	}
-	return NULL;
+	return _nicknames.find(nickname);
+}
+
+// ニックネームを変更する
+// 索引への登録が成功した時だけ古い名前を外して書き換えるので、索引と Client は常に一致する
+bool Server::setClientNickname(Client *client, const std::string &nickname)
+{
+	if (!_nicknames.insert(nickname, client))
+		return false; // 他のクライアントが使用中
+	// 大文字小文字だけの変更ならキーは同じなので古い名前は残す
+	std::string old_nick = client->getNickname();
+	if (!old_nick.empty() && !ircCaseEquals(old_nick, nickname))
+		_nicknames.erase(old_nick, client);
+	client->setNickname(nickname);
+	return true;
 }
 
 // クライアント削除
+// ループの途中で削除するとイベントの取りこぼしや fd の再利用が起こるため、
+// ここでは切断予約だけ行い、実際の削除はループの最後に reapClients で行う
 void Server::clearClients(int fd)
 {
-	std::map<int, Client *>::iterator it_client = _clients.find(fd);
-	if (it_client == _clients.end())
+	Client *client = getClient(fd);
+	if (!client)
 	{
-		std::cout << "Client not found for fd: " << fd << std::endl;
+		LOG_DEBUG("Client not found for fd: " << fd);
 		return; // クライアントが見つからない場合は何もしない
 	}
+	if (client->getDeconnexionStatus())
+		return; // 既に切断予約済み
+	client->getDeconnexionStatus() = true;
+	// 削除は担当スレッドが行う。別スレッドの担当なら起こして削除させる
+	Worker *owner = _connections.find(fd)->owner;
+	owner->disconnected.push_back(fd);
+	if (!pthread_equal(owner->thread, pthread_self()))
+		wakeWorker(*owner);
+}
+
+// 切断予約されたクライアントをまとめて削除する（_registry_lock を保持して呼ぶ）
+void Server::reapClients(Worker &worker)
+{
+	// destroyClient 中に新たな切断予約が入っても取りこぼさないようにインデックスで回す
+	for (size_t i = 0; i < worker.disconnected.size(); i++)
+		destroyClient(worker, worker.disconnected[i]);
+	worker.disconnected.clear();
+}
+
+// クライアントを実際に削除する（担当スレッドの reapClients からのみ呼ばれる）
+void Server::destroyClient(Worker &worker, int fd)
+{
+	Connection *conn = getConnection(worker, fd);
+	if (!conn || !conn->client)
+	{
+		LOG_DEBUG("Client not found for fd: " << fd);
+		return; // クライアントが見つからない場合は何もしない
+	}
+	Client *client = conn->client;
 	// クライアントのチャンネルからクライアントを削除
-	std::map<std::string, Channel *> channels = it_client->second->getChannels();
-	for (std::map<std::string, Channel *>::iterator it_channel = channels.begin(); it_channel != channels.end();)
+	// part() がクライアントのチャンネル一覧を書き換えるのでコピーしてから回す
+	Client::ChannelMap channels = client->getChannels();
+	for (Client::ChannelMap::iterator it_channel = channels.begin(); it_channel != channels.end();)
 	{
 		Channel *channel = it_channel->second;
 		// std::map<std::string, Channel *>::iterator toErase = it_channel;
 		++it_channel; // 次のチャンネルへ進む
+		if (client->getQuitStatus())
+		{
+			// QUIT を送ったクライアントはチャンネルから黙って外す（QUIT の後に PART を送らない）
+			std::string channel_name = channel->getName();
+			channel->removeOperator(*client);
+			channel->removeClient(*client);
+			if (channel->empty())
+				removeChannel(channel_name); // チャンネルが空になったら削除（channel はここで解放される）
+			continue;
+		}
 		ParsedMessage part_msg;
 		part_msg.command = "PART";
 		part_msg.params.push_back(channel->getName());
 		part_msg.trailing.clear(); // トレーリングメッセージをクリア
 		part(this, fd, part_msg);  // PART コマンドを実行
-								   // channel->removeClient(*it_client->second); // チャンネルからクライアントを削除
+								   // channel->removeClient(*client); // チャンネルからクライアントを削除
 								   // if (channel->getClients().empty())
 								   // {
 								   // 	removeChannel(channel->getName()); // チャンネルが空なら削除
 								   // }
 	}
-	// クライアントのファイルディスクリプタを閉じる
-	for (size_t i = 0; i < _fds.size(); i++)
+	// 残っている送信キュー（ERROR 行など）を 1 度だけ送ってみる
 	{
-		if (_fds[i].fd == fd)
-		{
-			_fds.erase(_fds.begin() + i);
-			break;
-		}
+		ScopedLock lock(conn->send_queue.mutex());
+		ssize_t sent = conn->send_queue.flush(fd);
+		if (sent > 0)
+			metricsAdd(worker.metrics.bytes_out, sent);
+		conn->send_queue.clear(); // 送れなかった分は捨てる（スロットは次の接続で使い回す）
 	}
+	// クライアントのファイルディスクリプタを監視対象から外して閉じる
+	worker.loop->remove(fd);
 	close(fd); // クライアントのソケットを閉じる
 	// クライアントの情報を削除
-	delete it_client->second; // クライアントのメモリを解放
-	_clients.erase(fd);		  // クライアントの情報を削除
-	_send_buffers.erase(fd);  // クライアントの送信バッファを削除
-	std::cout << RED << "Client <" << fd << "> Disconnected" << WHI << std::endl;
+	_nicknames.erase(client->getNickname(), client);
+	delete client; // クライアントのメモリを解放
+	conn->client = NULL;
+	_client_count--;
+	conn->recv_buffer.clear(); // 受信バッファをプールに返す
+	if (conn->ready)
+		worker.ready.erase(std::find(worker.ready.begin(), worker.ready.end(), fd));
+	conn->ready = false;
+	if (conn->paused_until)
+		worker.timers.erase(std::make_pair(conn->paused_until, fd));
+	conn->paused_until = 0;
+	__atomic_store_n(&conn->owner, (Worker *)NULL, __ATOMIC_RELEASE);
+	LOG_INFO(RED << "Client <" << fd << "> Disconnected" << WHI);
 }
 
 void Server::addChannel(Channel *channel)
@@ -156,14 +236,14 @@ void Server::removeChannel(const std::string &channel_name)
 	std::map<std::string, Channel *>::iterator it = _channels.find(channel_name);
 	if (it != _channels.end())
 	{
-		std::cout << RED << "Channel <" << channel_name << "> Removed" << WHI << std::endl;
+		LOG_INFO(RED << "Channel <" << channel_name << "> Removed" << WHI);
 		Channel *channel = it->second;
 		_channels.erase(it); // チャンネルを削除
 		delete channel;		 // チャンネルのメモリを解放
 	}
 	else
 	{
-		std::cout << RED << "Channel <" << channel_name << "> Not Found" << WHI << std::endl;
+		LOG_DEBUG(RED << "Channel <" << channel_name << "> Not Found" << WHI);
 	}
 }
 
@@ -171,9 +251,11 @@ void Server::removeChannel(const std::string &channel_name)
 void Server::signalHandler(int signum)
 {
 	(void)signum;
-	std::cout << std::endl
-			  << "Signal Received!" << std::endl;
-	_signal = true; // サーバーを停止するためのフラグを立てる
+	// シグナルハンドラの中では std::cout を使わない（async-signal-safe な write だけ）
+	const char msg[] = "\nSignal Received!\n";
+	ssize_t written = write(STDOUT_FILENO, msg, sizeof(msg) - 1);
+	(void)written;
+	__atomic_store_n(&_signal, 1, __ATOMIC_RELEASE); // サーバーを停止するためのフラグを立てる
 }
 
 void Server::clearChannels()
@@ -181,39 +263,64 @@ void Server::clearChannels()
 	// 全てのチャンネルを削除
 	for (std::map<std::string, Channel *>::iterator it = _channels.begin(); it != _channels.end();)
 	{
-		std::cout << RED << "Channel <" << it->first << "> Cleared" << WHI << std::endl;
+		LOG_DEBUG(RED << "Channel <" << it->first << "> Cleared" << WHI);
 		delete it->second; // チャンネルのメモリを解放
 		std::map<std::string, Channel *>::iterator toErase = it;
 		++it;					  // 次のイテレータを先に取得しておく
 		_channels.erase(toErase); // チャンネルを削除
 	}
-	std::cout << RED << "All channels cleared" << WHI << std::endl;
+	LOG_INFO(RED << "All channels cleared" << WHI);
 }
 
 // 全てのファイルディスクリプタを閉じる関数
 void Server::closeFds()
 {
+	stopWorkers(); //-> 他のスレッドが動いている間は閉じない
 	// クライアントソケットを閉じる
-	for (std::map<int, Client *>::iterator it = _clients.begin(); it != _clients.end();)
+	for (int fd = 0; fd < getFdLimit(); fd++)
 	{
-		if (it->second)
+		Connection *conn = _connections.find(fd);
+		if (conn && conn->client)
 		{
-			std::cout << RED << "Client <" << it->second->getFd() << "> Disconnected" << WHI << std::endl;
-			close(it->second->getFd()); // クライアントのソケットを閉じる
-			delete it->second;			// クライアントのメモリを解放
+			LOG_DEBUG(RED << "Client <" << fd << "> Disconnected" << WHI);
+			close(fd);			// クライアントのソケットを閉じる
+			delete conn->client; // クライアントのメモリを解放
+			conn->client = NULL;
+			conn->owner = NULL;
+			conn->send_queue.clear();
+			conn->recv_buffer.clear(); // イベントループ（とプール）を破棄する前に返す
 		}
-		// it = _clients.erase(it); // eraseは次のイテレータを返すのでそれを使うc++11
-		// eraseの返り値はvoidなので、イテレータを別途管理する必要がある
-		std::map<int, Client *>::iterator toErase = it;
-		++it; // 次のイテレータを先に取得しておく
-		_clients.erase(toErase);
 	}
+	_client_count = 0;
+	_nicknames.clear();
+	_metrics.close(); //-> イベントループより先に閉じる
 	// サーバーソケットを閉じる
 	if (_serSocketFd != -1)
 	{
 		close(_serSocketFd);
-		std::cout << RED << "Server <" << _serSocketFd << "> Disconnected" << WHI << std::endl;
+		LOG_INFO(RED << "Server <" << _serSocketFd << "> Disconnected" << WHI);
+		_serSocketFd = -1;
 	}
+	// イベントループを破棄
+	for (size_t i = 0; i < _workers.size(); i++)
+		_workers[i]->trace.flush(); //-> 溜まっているトレースを書き出してから閉じる
+	_trace_file.close();
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		delete _workers[i]->loop;
+		close(_workers[i]->wake_fds[0]);
+		close(_workers[i]->wake_fds[1]);
+		delete _workers[i];
+	}
+	_workers.clear();
+	if (_welcome)
+		_welcome->release();
+	_welcome = NULL;
+}
+
+void Server::setConfig(const ServerConfig &config)
+{
+	_config = config;
 }
 
 void Server::setPassword(const std::string &password)
@@ -230,7 +337,6 @@ const std::string &Server::getPassword() const
 void Server::serSocket()
 {
 	struct sockaddr_in add;			   // IPv4用のソケットアドレスを格納
-	struct pollfd newPoll;			   // poll() 用にソケットとその監視対象イベントを保持する
 	add.sin_family = AF_INET;		   // IPv4 (AF_INET) を使用。
 	add.sin_port = htons(this->_port); // ポート番号をネットワークバイトオーダー（ビッグエンディアン）に変換
 	// add.sin_addr.s_addr = INADDR_ANY;  // 任意のネットワークインターフェースで待ち受けることを意味する（0.0.0.0）
@@ -253,10 +359,8 @@ void Server::serSocket()
 	if (listen(_serSocketFd, SOMAXCONN) == -1) //-> listen for incoming connections and making the socket a passive socket
 		throw(std::runtime_error("listen() faild"));
 
-	newPoll.fd = _serSocketFd; //-> add the server socket to the pollfd
-	newPoll.events = POLLIN;   //-> set the event to POLLIN for reading data
-	newPoll.revents = 0;	   //-> set the revents to 0
-	_fds.push_back(newPoll);   //-> add the server socket to the pollfd
+	// 待ち受けソケットはレベルトリガで監視する（1 回の通知で受け付ける数に上限があるため）
+	_workers[0]->loop->add(_serSocketFd, EVENT_READ);
 }
 
 // サーバー起動
@@ -277,138 +381,621 @@ void Server::serverInit(const char *port, const char *password, struct tm *timei
 	std::cout << "Port: " << _port << std::endl;
 	std::cout << "Password: " << _password << std::endl;
 	std::cout << "----------------" << std::endl;
-	// サーバーソケットを作成
+	// 歓迎メッセージは毎回組み立てず、共有メッセージとして全員の送信キューに積む
+	_welcome = SharedMessage::create(_welcomemsg());
+	buildReplyCache(timeinfo);
+
+	// 接続表はプロセスが開ける fd の数だけ用意する（チャンクは使う時に確保）
+	struct rlimit nofile;
+	size_t max_fds = CONNTABLE_MAX_FDS;
+	if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur != RLIM_INFINITY && nofile.rlim_cur < max_fds)
+		max_fds = nofile.rlim_cur;
+	_connections.init(max_fds);
+
+	if (!_config.trace_file.empty())
+		_trace_file.open(_config.trace_file); //-> 各スレッドに渡すので addWorker より先に開く
+
+	// イベントループを作成してからサーバーソケットを作成
+	addWorker();
+	size_t threads = _config.threads;
+	if (threads > 1 && std::string(_workers[0]->loop->name()) != "epoll")
+	{
+		LOG_WARN("poll backend runs on a single thread");
+		threads = 1; //-> PollLoop は別スレッドからの add / modify に対応していない
+	}
+	while (_workers.size() < threads)
+		addWorker();
 	serSocket();
+	if (_config.metrics_port || !_config.metrics_socket.empty())
+		_metrics.open(_workers[0]->loop, _config.metrics_port, _config.metrics_socket);
 
 	std::cout << GRE << "Server <" << _serSocketFd << "> Connected" << WHI << std::endl;
 	std::cout << "Waiting to accept a connection...\n";
 	std::cout << "IPaddress: " << inet_ntoa(getIpAdd()) << std::endl;
 	std::cout << "Port: " << _port << std::endl;
+	std::cout << "Event backend: " << _workers[0]->loop->name() << std::endl;
+	std::cout << "Threads: " << _workers.size() << std::endl;
+	if (_config.metrics_port)
+		std::cout << "Metrics: http://127.0.0.1:" << _config.metrics_port << "/metrics" << std::endl;
+	else if (!_config.metrics_socket.empty())
+		std::cout << "Metrics: unix:" << _config.metrics_socket << " /metrics" << std::endl;
 	std::cout << "----------------" << std::endl;
 	std::cout << "Server is running..." << std::endl;
 	std::cout << "Press Ctrl + C to stop the server" << std::endl;
 
-	// シグナルを受け取るまでループ
-	while (!_signal)
+	// worker 0 はこのスレッドで動かす。シグナルを受け取るまで戻らない
+	startWorkers();
+	runWorker(*_workers[0]);
+	stopWorkers();
+	clearChannels(); //-> delete all channels when the server stops
+	closeFds();		 //-> close the file descriptors when the server stops
+	logPoolStats();	 //-> 全て解放した後なので in use が 0 でなければリーク
+}
+
+// オブジェクトプールの使用状況を表示する
+void Server::logPoolStats() const
+{
+	std::vector<std::pair<std::string, PoolStats> > pools = ObjectPoolBase::allStats();
+	for (size_t i = 0; i < pools.size(); i++)
+	{
+		const PoolStats &stats = pools[i].second;
+		LOG_INFO("Pool " << pools[i].first << ": in use " << stats.in_use << " / " << stats.capacity
+						 << " (" << stats.slabs << " slabs, peak " << stats.peak << ")");
+	}
+}
+
+// /metrics の接続を処理する（worker 0 のスレッドから）
+void Server::handleMetricsEvent(int fd, int events)
+{
+	std::string path;
+	if (!_metrics.handle(fd, events, path))
+		return;
+	if (path == "/metrics" || path == "/")
+		_metrics.respond(fd, 200, renderMetrics());
+	else
+		_metrics.respond(fd, 404, "not found\n");
+}
+
+// 予算を超えた周回を報告する（まれにしか通らないので、ここで初めてロックを取って詳細を調べる）
+// 最も遅かったコマンドの行から宛先を取り出し、チャンネルならその時点の参加人数を添える
+void Server::reportStall(Worker &worker)
+{
+	const LoopTrace &trace = worker.trace;
+	LOG_WARN("Stall: worker " << worker.id << " busy " << trace.busy() / 1000 << " us (budget "
+							  << _config.stall_budget_ms << " ms): accept " << trace.phase_time[PHASE_ACCEPT] / 1000
+							  << " read " << trace.phase_time[PHASE_READ] / 1000
+							  << " dispatch " << trace.phase_time[PHASE_DISPATCH] / 1000
+							  << " flush " << trace.phase_time[PHASE_FLUSH] / 1000
+							  << " reap " << trace.phase_time[PHASE_REAP] / 1000
+							  << " other " << trace.phase_time[PHASE_OTHER] / 1000 << " us, "
+							  << trace.events << " events, " << trace.commands << " commands");
+	if (trace.slowest_fd == -1)
+		return;
+
+	std::string nick = trace.slowest_nick[0] ? trace.slowest_nick : "*"; //-> NICK 前なら名前はまだ無い
+	ScopedLock lock(_registry_lock);
+	std::string target = "-";
+	long members = -1;
+	StringView line = {trace.slowest_line, trace.slowest_size};
+	MessageView view;
+	if (parseMessage(line, view) && view.param_count > 0)
 	{
-		// poll() の直前で POLLOUT を必要に応じてセット
-		for (size_t i = 1; i < _fds.size(); ++i)
+		target = viewToString(view.params[0]);
+		target = target.substr(0, target.find(',')); //-> 複数の宛先は最初の 1 つだけ
+		if (!target.empty() && (target[0] == '#' || target[0] == '&'))
 		{
-			if (!getSendBuffer(_fds[i].fd).empty())
-				_fds[i].events |= POLLOUT; // 書き込み可能イベントを監視
-			else
-				_fds[i].events &= ~POLLOUT; // 書き込み不要なら解除
+			Channel *channel = getChannel(target.substr(1));
+			members = channel ? static_cast<long>(channel->getMembers().size()) : 0;
 		}
+	}
+	LOG_WARN("Stall: worker " << worker.id << " slowest " << commandName(trace.slowest_command) << " "
+							  << trace.slowest / 1000 << " us from fd " << trace.slowest_fd << " (client " << trace.slowest_client
+							  << " " << nick << ") target " << target << " (" << members << " members)");
+}
+
+// Prometheus のヒストグラムの区間 (le)
+static const uint64_t g_seconds_bounds[] = {
+	1000UL, 2500UL, 5000UL, 10000UL, 25000UL, 50000UL, 100000UL, 250000UL, 500000UL,			  // 1us 〜 500us
+	1000000UL, 2500000UL, 5000000UL, 10000000UL, 25000000UL, 50000000UL, 100000000UL, 250000000UL, // 1ms 〜 250ms
+	500000000UL, 1000000000UL, 2500000000UL, 5000000000UL, 10000000000UL};						  // 500ms 〜 10s
+static const uint64_t g_bytes_bounds[] = {0, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304};
+
+#define BOUNDS(array) array, sizeof(array) / sizeof(array[0])
+
+// 全スレッドの計測値を足し合わせる
+// 各スレッドの計測値は relaxed で読むので、スレッドを止めずに読める（1 回分ずれることはある）
+std::string Server::renderMetrics()
+{
+	std::vector<Histogram> commands(CMD_NONE + 1);
+	Histogram sendq;
+	uint64_t bytes_in = 0;
+	uint64_t bytes_out = 0;
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		const WorkerMetrics &metrics = _workers[i]->metrics;
+		for (size_t c = 0; c <= CMD_NONE; c++)
+			metrics.command_time[c].load(commands[c]);
+		metrics.sendq_depth.load(sendq);
+		bytes_in += __atomic_load_n(&metrics.bytes_in, __ATOMIC_RELAXED);
+		bytes_out += __atomic_load_n(&metrics.bytes_out, __ATOMIC_RELAXED);
+	}
+
+	MetricsWriter out;
+	out.header("ircserv_commands_total", "counter", "Commands processed, by command.");
+	for (size_t c = 0; c <= CMD_NONE; c++)
+		out.value("ircserv_commands_total", std::string("command=\"") + commandName(static_cast<CommandIndex>(c)) + "\"", commands[c].count());
+	out.header("ircserv_command_duration_seconds", "histogram", "Time spent handling one command line.");
+	for (size_t c = 0; c <= CMD_NONE; c++)
+		out.histogram("ircserv_command_duration_seconds", std::string("command=\"") + commandName(static_cast<CommandIndex>(c)) + "\"",
+					  commands[c], BOUNDS(g_seconds_bounds), 1e-9);
+	out.header("ircserv_loop_iteration_seconds", "histogram", "Event loop iteration time excluding the wait, by worker thread.");
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		Histogram loop_time;
+		_workers[i]->metrics.loop_time.load(loop_time);
+		std::ostringstream label;
+		label << "worker=\"" << i << "\"";
+		out.histogram("ircserv_loop_iteration_seconds", label.str(), loop_time, BOUNDS(g_seconds_bounds), 1e-9);
+	}
+	out.header("ircserv_recv_buffers", "gauge", "Receive buffers lent to connections, by worker thread.");
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		std::ostringstream label;
+		label << "worker=\"" << i << "\"";
+		out.value("ircserv_recv_buffers", label.str(), static_cast<uint64_t>(_workers[i]->recv_pool.inUse()));
+	}
+	out.header("ircserv_recv_pool_cached_bytes", "gauge", "Bytes kept in the free lists of the receive buffer pool, by worker thread.");
+	for (size_t i = 0; i < _workers.size(); i++)
+	{
+		std::ostringstream label;
+		label << "worker=\"" << i << "\"";
+		out.value("ircserv_recv_pool_cached_bytes", label.str(), static_cast<uint64_t>(_workers[i]->recv_pool.cachedBytes()));
+	}
+	out.header("ircserv_sendq_depth_bytes", "histogram", "Send queue size when a client socket becomes writable.");
+	out.histogram("ircserv_sendq_depth_bytes", "", sendq, BOUNDS(g_bytes_bounds), 1);
+	out.header("ircserv_received_bytes_total", "counter", "Bytes received from clients.");
+	out.value("ircserv_received_bytes_total", "", bytes_in);
+	out.header("ircserv_sent_bytes_total", "counter", "Bytes sent to clients.");
+	out.value("ircserv_sent_bytes_total", "", bytes_out);
+
+	ScopedLock lock(_registry_lock);
+	out.header("ircserv_clients", "gauge", "Connected clients.");
+	out.value("ircserv_clients", "", static_cast<uint64_t>(_client_count));
+	out.header("ircserv_channels", "gauge", "Existing channels.");
+	out.value("ircserv_channels", "", static_cast<uint64_t>(_channels.size()));
+	out.header("ircserv_sendq_dropped_bytes_total", "counter", "Bytes dropped by the send queue limits.");
+	out.value("ircserv_sendq_dropped_bytes_total", "", static_cast<uint64_t>(_sendq_dropped_bytes));
+	out.header("ircserv_sendq_disconnects_total", "counter", "Clients disconnected for exceeding the send queue limit.");
+	out.value("ircserv_sendq_disconnects_total", "", static_cast<uint64_t>(_sendq_disconnects));
+	out.header("ircserv_accept_throttled_total", "counter", "Connections refused by the accept rate limit.");
+	out.value("ircserv_accept_throttled_total", "", static_cast<uint64_t>(_accept_throttled));
+	// Client / Channel のスラブプール（確保・解放は _registry_lock の下で行われる）
+	PoolStats client_pool = Client::poolStats();
+	PoolStats channel_pool = Channel::poolStats();
+	out.header("ircserv_pool_objects", "gauge", "Objects in use in the slab pools, by pool.");
+	out.value("ircserv_pool_objects", "pool=\"Client\"", static_cast<uint64_t>(client_pool.in_use));
+	out.value("ircserv_pool_objects", "pool=\"Channel\"", static_cast<uint64_t>(channel_pool.in_use));
+	out.header("ircserv_pool_capacity_objects", "gauge", "Allocated slots in the slab pools (in use and free), by pool.");
+	out.value("ircserv_pool_capacity_objects", "pool=\"Client\"", static_cast<uint64_t>(client_pool.capacity));
+	out.value("ircserv_pool_capacity_objects", "pool=\"Channel\"", static_cast<uint64_t>(channel_pool.capacity));
+	return out.str();
+}
 
-		// pollシステムコールで接続要求やクライアントからの受信を監視
-		if ((poll(&_fds[0], _fds.size(), -1) == -1) && !_signal)
+// イベントループを 1 本追加する（スレッドはまだ起動しない）
+void Server::addWorker()
+{
+	Worker *worker = new Worker();
+	worker->server = this;
+	worker->id = _workers.size();
+	worker->thread = pthread_self();
+	worker->running = false;
+	worker->loop = NULL;
+	worker->wake_fds[0] = -1;
+	worker->wake_fds[1] = -1;
+	worker->trace.worker = worker->id;
+	worker->trace.file = _trace_file.enabled() ? &_trace_file : NULL;
+	_workers.push_back(worker); //-> 途中で失敗しても closeFds で解放できるよう先に登録する
+	worker->loop = EventLoop::create(_config.backend);
+	if (pipe(worker->wake_fds) == -1)
+		throw(std::runtime_error("pipe() faild"));
+	if (fcntl(worker->wake_fds[0], F_SETFL, O_NONBLOCK) == -1 || fcntl(worker->wake_fds[1], F_SETFL, O_NONBLOCK) == -1)
+		throw(std::runtime_error("faild to set option (O_NONBLOCK) on pipe"));
+	worker->loop->add(worker->wake_fds[0], EVENT_READ);
+}
+
+// worker 1 以降をそれぞれのスレッドで起動する
+void Server::startWorkers()
+{
+	// SIGINT / SIGQUIT はメインスレッド (worker 0) だけが受け取るようにする
+	sigset_t blocked;
+	sigset_t previous;
+	sigemptyset(&blocked);
+	sigaddset(&blocked, SIGINT);
+	sigaddset(&blocked, SIGQUIT);
+	pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+	_workers[0]->thread = pthread_self();
+	for (size_t i = 1; i < _workers.size(); i++)
+	{
+		if (pthread_create(&_workers[i]->thread, NULL, &Server::workerMain, _workers[i]) != 0)
+		{
+			pthread_sigmask(SIG_SETMASK, &previous, NULL);
+			throw(std::runtime_error("pthread_create() faild"));
+		}
+		_workers[i]->running = true;
+	}
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+}
+
+// 全スレッドに終了を知らせて、終わるまで待つ
+void Server::stopWorkers()
+{
+	__atomic_store_n(&_signal, 1, __ATOMIC_RELEASE);
+	for (size_t i = 1; i < _workers.size(); i++)
+	{
+		if (!_workers[i]->running)
+			continue;
+		wakeWorker(*_workers[i]);
+		pthread_join(_workers[i]->thread, NULL);
+		_workers[i]->running = false;
+	}
+}
+
+void Server::wakeWorker(Worker &worker)
+{
+	// パイプが一杯なら既に起こされているので失敗しても構わない
+	char c = 0;
+	if (write(worker.wake_fds[1], &c, 1) == -1)
+		return;
+}
+
+void *Server::workerMain(void *arg)
+{
+	Worker *worker = static_cast<Worker *>(arg);
+	try
+	{
+		worker->server->runWorker(*worker);
+	}
+	catch (const std::exception &e)
+	{
+		LOG_ERROR(e.what());
+		__atomic_store_n(&_signal, 1, __ATOMIC_RELEASE); //-> 1 つでも落ちたらサーバー全体を止める
+		worker->server->wakeWorker(*worker->server->_workers[0]);
+	}
+	return NULL;
+}
+
+// イベントループ本体
+// 受信・送信のシステムコールはロックの外で行い、コマンドの処理中だけ _registry_lock を保持する
+void Server::runWorker(Worker &worker)
+{
+	LoopTrace &trace = worker.trace;
+	while (!__atomic_load_n(&_signal, __ATOMIC_ACQUIRE))
+	{
+		// 接続要求やクライアントからの受信を監視
+		// 書き込み監視は送信バッファが空でなくなった時だけ登録されている
+		// flood 制御で止めている fd があれば、最も早い再開時刻までで wait を切り上げる
+		// 処理しきれていない入力 (ready) があればブロックせずにイベントだけ拾う
+		int timeout = worker.ready.empty() ? nextTimeout(worker) : 0;
+		trace.start();
+		if ((worker.loop->wait(worker.events, timeout) == -1) && !__atomic_load_n(&_signal, __ATOMIC_ACQUIRE))
 			throw(std::runtime_error("poll() faild"));
+		trace.mark(PHASE_READ); //-> ここから 1 周の終わりまでを処理時間として測る
+		trace.events = worker.events.size();
 
-		for (size_t i = 0; i < _fds.size(); i++) //-> check all file descriptors
+		for (size_t i = 0; i < worker.events.size(); i++) //-> check only the ready file descriptors
 		{
-			if (_fds[i].revents & POLLIN) //-> check if there is data to read
+			int fd = worker.events[i].fd;
+			int events = worker.events[i].events;
+			if (fd == _serSocketFd)
 			{
-				if (_fds[i].fd == _serSocketFd)
+				trace.enter(PHASE_ACCEPT);
+				if (events & EVENT_READ)
 					acceptNewClient(); //-> accept new client
-				else
-					// ReceiveNewData(fds[i].fd); //-> receive new data from a registered client
-					handleSocketReadable(_fds[i].fd); //-> handle the socket readable
+				continue;
+			}
+			if (worker.id == 0 && _metrics.owns(fd))
+			{
+				trace.enter(PHASE_OTHER);
+				handleMetricsEvent(fd, events);
+				continue;
 			}
-			if (_fds[i].revents & POLLOUT) //-> check if there is data to write
-				sendBuffer(_fds[i].fd);
+			if (fd == worker.wake_fds[0])
+			{
+				trace.enter(PHASE_OTHER);
+				char drain[64];
+				while (read(fd, drain, sizeof(drain)) > 0)
+					;
+				continue;
+			}
+			if (events & (EVENT_READ | EVENT_ERROR)) //-> check if there is data to read
+			{
+				trace.enter(PHASE_READ);
+				handleSocketReadable(worker, fd); //-> handle the socket readable
+			}
+			if (events & EVENT_WRITE) //-> check if there is data to write
+			{
+				trace.enter(PHASE_FLUSH);
+				sendBuffer(worker, fd);
+			}
+		}
+		trace.enter(PHASE_READ);
+		runReady(worker);  //-> 前回打ち切ったクライアントの続きを 1 巡だけ処理
+		runTimers(worker); //-> 再開時刻になったクライアントの入力を処理
+		trace.enter(PHASE_REAP);
+		{
+			ScopedLock lock(_registry_lock);
+			reapClients(worker);		//-> このイテレーションで切断されたクライアントを削除
+			armRequestedWrites(worker); //-> 他スレッドが送信キューに積んだ fd の書き込み監視
 		}
+		trace.mark(PHASE_WAIT);
+		worker.metrics.loop_time.record(trace.busy());
+		if (_config.stall_budget_ms && trace.busy() > _config.stall_budget_ms * 1000000UL)
+			reportStall(worker);
+		trace.finish();
 	}
-	clearChannels(); //-> delete all channels when the server stops
-	closeFds();		 //-> close the file descriptors when the server stops
 }
 
-// 新しいクライアントを受け入れる関数
-void Server::acceptNewClient()
+// ノンブロッキングかつ close-on-exec のソケットとして accept する
+static int acceptSocket(int fd, struct sockaddr_in *addr, socklen_t *len)
 {
-	Client cli;
-	struct sockaddr_in cliadd;
-	struct pollfd newPoll;
-	socklen_t len = sizeof(cliadd);
-
-	int incofd = accept(_serSocketFd, (sockaddr *)&(cliadd), &len); //-> accept the new client
+#ifdef __linux__
+	return accept4(fd, (sockaddr *)addr, len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+	int incofd = accept(fd, (sockaddr *)addr, len);
 	if (incofd == -1)
+		return -1;
+	if (fcntl(incofd, F_SETFL, O_NONBLOCK) == -1 || fcntl(incofd, F_SETFD, FD_CLOEXEC) == -1)
 	{
-		std::cout << "accept() failed" << std::endl;
-		return;
+		close(incofd);
+		return -1;
 	}
+	return incofd;
+#endif
+}
 
-	if (fcntl(incofd, F_SETFL, O_NONBLOCK) == -1) //-> set the socket option (O_NONBLOCK) for non-blocking socket
+// 新しいクライアントを受け入れる関数
+// 待ち受けソケットはレベルトリガなので、EAGAIN になるか 1 回分の上限に達するまで受け付け、
+// 残りは次の wait で処理する（その間も既存クライアントの処理が止まらないように）
+void Server::acceptNewClient()
+{
+	for (int n = 0; n < ACCEPT_BATCH_MAX; n++)
 	{
-		std::cout << "fcntl() failed" << std::endl;
-		return;
-	}
+		struct sockaddr_in cliadd;
+		socklen_t len = sizeof(cliadd);
+		int incofd = acceptSocket(_serSocketFd, &cliadd, &len); //-> accept the new client
+		if (incofd == -1)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue; //-> 相手が先に切断しただけ
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				LOG_WARN("accept() failed: " << strerror(errno));
+			return;
+		}
 
-	newPoll.fd = incofd;						//-> add the client socket to the pollfd
-	newPoll.events = POLLIN;					//-> set the event to POLLIN for reading data
-	newPoll.revents = 0;						//-> set the revents to 0
-	cli.setFd(incofd);							//-> set the client file descriptor
-	cli.setIpAdd(inet_ntoa((cliadd.sin_addr))); //-> convert the ip address to string and set it
-	// _clients.push_back(cli);					//-> add the client to the vector of clients
-	Client *newClient = new Client(incofd, inet_ntoa(cliadd.sin_addr)); //-> add the client to the map of clients
-	_clients.insert(std::make_pair(incofd, newClient));					//-> insert the client into the map of clients
-	// _clients[incofd]->setIpAdd(inet_ntoa(cliadd.sin_addr)); //
-	_fds.push_back(newPoll); //-> add the client socket to the pollfd
-	std::cout << GRE << "Client <" << incofd << "> Connected" << WHI << std::endl;
-	std::string welcome = _welcomemsg();
-	if (send(incofd, welcome.c_str(), welcome.length(), 0) == -1)
-		std::cout << "send() error " << std::endl;
-	// std::cout << "[" << currentDateTime() << "]: new connection from "
-	// 		  << inet_ntoa(((struct sockaddr_in *)&remotaddr)->sin_addr)
-	// 		  << " on socket " << newfd << std::endl;
-}
+		char ip[INET_ADDRSTRLEN]; //-> inet_ntoa と違いスレッドセーフ
+		if (!inet_ntop(AF_INET, &cliadd.sin_addr, ip, sizeof(ip)))
+			ip[0] = '\0';
 
-// 受信したソケットが読み取り可能な場合の処理
-// 受信したデータをバッファに追加し、\r\nで分割して処理する
-void Server::handleSocketReadable(int client_fd)
-{
-	char buf[1024];
-	memset(buf, 0, sizeof(buf));
+		// 再接続の嵐ではここで弾き、登録もイベントループへの追加もしない
+		if (isAcceptThrottled(cliadd.sin_addr.s_addr))
+		{
+			std::string error = RPL_CLOSINGLINK(std::string(ip), std::string("Connection rate exceeded"));
+			send(incofd, error.c_str(), error.size(), MSG_DONTWAIT); //-> 閉じるだけなので送れなくても構わない
+			close(incofd);
+			_accept_throttled++;
+			LOG_WARN(RED << "Connection from " << ip << " refused (rate limit)" << WHI);
+			continue;
+		}
 
-	ssize_t bytes = recv(client_fd, buf, sizeof(buf) - 1, 0);
+		// 返信は 1 行ずつ小さく書き出すので、Nagle で相手の遅延 ACK (最大 40ms) を待たないようにする
+		int nodelay = 1;
+		setsockopt(incofd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
 
-	if (bytes <= 0)
-	{							 //-> check if the client disconnected
-		clearClients(client_fd); //-> clear the client
-		return;
+		// 接続はスレッドに順番に割り当てる。epoll への登録がそのままスレッドへの受け渡しになる
+		Worker *worker = _workers[_next_worker];
+		_next_worker = (_next_worker + 1) % _workers.size();
+		ScopedLock lock(_registry_lock);
+		Connection *conn = _connections.open(incofd);
+		if (!conn)
+		{
+			close(incofd); //-> RLIMIT_NOFILE を後から上げた場合など、表に入らない fd
+			continue;
+		}
+		conn->client = new Client(incofd, ip); //-> add the client to the table of clients
+		_client_count++;
+		__atomic_store_n(&conn->owner, worker, __ATOMIC_RELEASE); //-> 担当スレッドは getConnection の acquire で受け取る
+		worker->loop->add(incofd, EVENT_READ | EVENT_EDGE);		   //-> add the client socket to the event loop
+		LOG_INFO(GRE << "Client <" << incofd << "> Connected" << WHI);
+		addToClientBuffer(incofd, _welcome); //-> 他の返信と同じく送信キュー経由で送る
 	}
+}
 
-	buf[bytes] = '\0';
-	// recv_buffer += buf;
-	_recv_buffers[client_fd] += std::string(buf); //-> add the received data to the buffer
-
-	// "\r\n" を "\n" に置換して正規化
-	size_t pos;
-	while ((pos = _recv_buffers[client_fd].find("\r\n")) != std::string::npos)
+// 接続レートの上限を超えているか確認し、超えていなければ 1 接続分を数える
+// 1 秒ごとの固定窓で数え、窓が変わったら IP ごとの記録も捨てる（メモリが増え続けない）
+bool Server::isAcceptThrottled(in_addr_t ip)
+{
+	time_t now = time(NULL);
+	if (now != _accept_window)
+	{
+		_accept_window = now;
+		_accept_count = 0;
+		_accept_per_ip.clear();
+	}
+	if (_config.accept_rate && _accept_count >= _config.accept_rate)
+		return true;
+	if (_config.accept_ip_rate)
 	{
-		_recv_buffers[client_fd].replace(pos, 2, "\n");
+		size_t &count = _accept_per_ip[ip];
+		if (count >= _config.accept_ip_rate)
+			return true;
+		count++;
 	}
+	_accept_count++;
+	return false;
+}
 
-	// "\n"が無い場合は何もしない
+// 受信したソケットが読み取り可能な場合の処理
+// 受信バッファへ直接 recv し、改行までの 1 行ずつを処理する
+// recv はロックの外で行い、溜まった行はロックを 1 回取ってまとめて処理する
+void Server::handleSocketReadable(Worker &worker, int client_fd)
+{
+	Connection *conn = getConnection(worker, client_fd);
+	if (!conn)
+		return;
+	if (conn->paused_until)
+		return; //-> flood 制御で止めている間は読まない（再開は runTimers から）
+	if (conn->ready)
+		return; //-> 続きは runReady で順番に処理する
+	LineBuffer &buffer = conn->recv_buffer;
+	buffer.setPool(&worker.recv_pool); //-> 前の接続が別スレッドの担当だった場合だけ切り替わる
 
-	// 受信バッファから1行ずつ処理（"\n" 区切り）
-	while ((pos = _recv_buffers[client_fd].find('\n')) != std::string::npos)
+	// エッジトリガでは次の通知が来ないので EAGAIN になるまで読み切る
+	while (true)
 	{
-		std::string line = _recv_buffers[client_fd].substr(0, pos);
-		_recv_buffers[client_fd].erase(0, pos + 1);
+		// 先に溜まっている行を処理する（一時停止から再開した場合はここに残っている）
+		if (buffer.size() > 0 && !processLines(worker, *conn))
+			return;
+		char *dst = buffer.prepare(LINEBUF_READ_CHUNK);
+		ssize_t bytes = recv(client_fd, dst, buffer.writable(), 0);
 
-		// 念のため末尾の '\r' を除去
-		if (!line.empty() && line[line.size() - 1] == '\r')
+		if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
 		{
-			line.erase(line.size() - 1);
+			buffer.release(); //-> 読み切って行も残っていなければ、次に届くまでメモリを持たない
+			break;			  //-> no more data for now
 		}
+		if (bytes <= 0)
+		{ //-> check if the client disconnected
+			ScopedLock lock(_registry_lock);
+			clearClients(client_fd); //-> clear the client
+			return;
+		}
+		buffer.commit(bytes);
+		metricsAdd(worker.metrics.bytes_in, bytes);
+	}
+}
 
-		if (!line.empty())
+// 受信バッファの行を 1 行ずつ処理する
+// 切断予約された、flood 制御で一時停止した、または行数の上限に達した場合は false を返し、それ以上読まない
+// 上限に達した fd は ready に入れ、他のクライアントを 1 巡させてから続きを処理する
+bool Server::processLines(Worker &worker, Connection &conn)
+{
+	ScopedLock lock(_registry_lock);
+	int client_fd = conn.fd;
+	LineBuffer &buffer = conn.recv_buffer;
+	Client *client = conn.client;
+	if (!client || client->getDeconnexionStatus())
+		return false; //-> 切断予約済みのクライアントは無視
+
+	// 受信バッファから1行ずつ処理（"\r\n" または "\n" 区切り）
+	StringView line;
+	unsigned long resume_at;
+	size_t processed = 0;
+	while (true)
+	{
+		if (_config.line_quota && processed >= _config.line_quota)
 		{
-			handleClientMessage(line, client_fd);
+			worker.ready.push_back(client_fd);
+			conn.ready = true;
+			return false;
 		}
+		// 予算を使い切ったら残りの行はバッファに残したまま止める (fake lag)
+		if (isFlooding(client, resume_at))
+		{
+			pauseInput(worker, conn, resume_at);
+			return false;
+		}
+		if (!buffer.nextLine(line))
+			return true;
+		if (line.size == 0)
+			continue;
+		unsigned long start = worker.trace.mark(PHASE_DISPATCH);
+		CommandIndex command = handleClientMessage(line, client_fd);
+		unsigned long end = worker.trace.mark(PHASE_READ);
+		worker.metrics.command_time[command].record(end - start);
+		worker.trace.command(client_fd, client->getId(), client->getNickname(), command, line, start, end);
+		processed++;
+		if (client->getDeconnexionStatus())
+			return false; //-> QUIT などで切断予約済み
+	}
+}
+
+// 前回のループで行数の上限に達した fd を、到着順に 1 回ずつ処理する
+// ここで再び上限に達した fd は次のループに回るので、忙しいクライアントが何人いても順番は公平になる
+void Server::runReady(Worker &worker)
+{
+	if (worker.ready.empty())
+		return;
+	std::vector<int> turn;
+	turn.swap(worker.ready);
+	for (size_t i = 0; i < turn.size(); i++)
+	{
+		Connection *conn = getConnection(worker, turn[i]);
+		if (conn)
+			conn->ready = false;
+	}
+	for (size_t i = 0; i < turn.size(); i++)
+		handleSocketReadable(worker, turn[i]);
+}
+
+// コマンド 1 つ分のトークンを消費する
+// トークンバケットを「仮想時刻」で表す: 1 トークン消費するごとに 1/flood_rate 秒進め、
+// 現在時刻より flood_burst トークン分以上先に進んだら予算切れとする
+void Server::chargeFlood(Client *client, unsigned int cost)
+{
+	if (_config.flood_rate == 0)
+		return;
+	unsigned long now = getMonotonicMicros();
+	unsigned long &clock = client->getFloodClock();
+	if (clock < now)
+		clock = now; //-> しばらく静かだったクライアントは満タンから
+	clock += cost * (1000000UL / _config.flood_rate);
+}
+
+bool Server::isFlooding(Client *client, unsigned long &resume_at)
+{
+	if (_config.flood_rate == 0)
+		return false;
+	unsigned long window = _config.flood_burst * (1000000UL / _config.flood_rate);
+	unsigned long clock = client->getFloodClock();
+	if (clock <= getMonotonicMicros() + window)
+		return false;
+	resume_at = clock - window;
+	return true;
+}
+
+void Server::pauseInput(Worker &worker, Connection &conn, unsigned long resume_at)
+{
+	if (conn.paused_until)
+		return;
+	conn.paused_until = resume_at;
+	worker.timers.insert(std::make_pair(resume_at, conn.fd));
+}
+
+void Server::runTimers(Worker &worker)
+{
+	unsigned long now = getMonotonicMicros();
+	while (!worker.timers.empty() && worker.timers.begin()->first <= now)
+	{
+		int fd = worker.timers.begin()->second;
+		worker.timers.erase(worker.timers.begin());
+		Connection *conn = getConnection(worker, fd);
+		if (conn)
+			conn->paused_until = 0;
+		handleSocketReadable(worker, fd); //-> 残っている行を処理して、続きを読む
 	}
 }
 
+int Server::nextTimeout(const Worker &worker) const
+{
+	if (worker.timers.empty())
+		return -1;
+	unsigned long now = getMonotonicMicros();
+	unsigned long next = worker.timers.begin()->first;
+	if (next <= now)
+		return 0;
+	return static_cast<int>((next - now + 999) / 1000); //-> 切り上げて早起きしないようにする
+}
+
 // void Server::sendBuffers()
 // {
 // 	for (std::map<int, std::string>::iterator it = _send_buffers.begin(); it != _send_buffers.end(); ++it)
@@ -421,7 +1008,7 @@ void Server::handleSocketReadable(int client_fd)
 // 			ssize_t sent = send(client_fd, buffer.c_str(), buffer.length(), 0);
 // 			if (sent == -1)
 // 			{
-// 				std::cerr << RED << "Failed to send to client <" << client_fd << ">" << WHI << std::endl;
+// 				LOG_WARN(RED << "Failed to send to client <" << client_fd << ">" << WHI);
 // 				clearClients(client_fd); // エラー時にクライアントを切断しても良い
 // 			}
 // 			else
@@ -432,48 +1019,132 @@ void Server::handleSocketReadable(int client_fd)
 // 	}
 // }
 
-void Server::sendBuffer(int client_fd)
+// クライアントの送信キューを送れるだけ送る（担当スレッドから呼ばれる）
+// writev の間は _registry_lock を離し、送信キューのロックだけを保持する
+void Server::sendBuffer(Worker &worker, int client_fd)
 {
-	// クライアントの送信バッファにメッセージを追加
-	std::map<int, std::string>::iterator it = _send_buffers.find(client_fd);
-	if (it != _send_buffers.end())
+	SendQueue *queue;
 	{
-		std::string &buffer = it->second;
-		if (!buffer.empty())
-		{
-			ssize_t sent = send(client_fd, buffer.c_str(), buffer.length(), 0);
-			if (sent == -1)
-			{
-				std::cerr << RED << "Failed to send to client <" << client_fd << ">" << WHI << std::endl;
-				clearClients(client_fd); // エラー時にクライアントを切断しても良い
-			}
-			else
-			{
-				buffer.erase(0, sent); // 送信済み分を削除
-			}
-		}
+		ScopedLock lock(_registry_lock);
+		queue = getSendQueue(client_fd);
+		if (!queue)
+			return;
+		queue->mutex().lock(); //-> キューを削除するのは担当スレッド（このスレッド）だけ
+	}
+	worker.metrics.sendq_depth.record(queue->bytes());
+	ssize_t sent = queue->flush(client_fd);
+	if (sent > 0)
+		metricsAdd(worker.metrics.bytes_out, sent);
+	// 空になったので書き込み監視を解除
+	if (sent != -1 && queue->empty())
+		worker.loop->modify(client_fd, EVENT_READ | EVENT_EDGE);
+	queue->mutex().unlock();
+	if (sent == -1)
+	{
+		ScopedLock lock(_registry_lock);
+		LOG_WARN(RED << "Failed to send to client <" << client_fd << ">" << WHI);
+		clearClients(client_fd); // エラー時にクライアントを切断しても良い
 	}
 }
 
 void Server::addToClientBuffer(int client_fd, const std::string &message)
 {
-	// クライアントのバッファにメッセージを追加
-	std::map<int, Client *>::iterator it = _clients.find(client_fd);
-	if (it != _clients.end())
+	// 1 人宛てのメッセージは送信キュー末尾のチャンクに追記する
+	SendQueue *queue = getSendQueue(client_fd);
+	if (!queue)
+		return;
+	ScopedLock lock(queue->mutex());
+	if (reserveSendQueue(client_fd, *queue, message.size()))
+		queue->push(message);
+}
+
+void Server::addToClientBuffer(int client_fd, const Reply &reply)
+{
+	// Reply のバッファから直接コピーする（std::string を経由しない）
+	SendQueue *queue = getSendQueue(client_fd);
+	if (!queue)
+		return;
+	ScopedLock lock(queue->mutex());
+	if (reserveSendQueue(client_fd, *queue, reply.size()))
+		queue->push(reply.data(), reply.size());
+}
+
+void Server::addToClientBuffer(int client_fd, SharedMessage *message)
+{
+	// クライアントの送信キューにメッセージの参照を追加（コピーはしない）
+	SendQueue *queue = getSendQueue(client_fd);
+	if (!queue)
+		return;
+	ScopedLock lock(queue->mutex());
+	if (reserveSendQueue(client_fd, *queue, message->size()))
+		queue->push(message);
+}
+
+// 送信キューを返す（クライアントがいない、または切断予約済みなら NULL）
+SendQueue *Server::getSendQueue(int client_fd)
+{
+	Connection *conn = _connections.find(client_fd);
+	if (!conn || !conn->client || conn->client->getDeconnexionStatus())
+		return NULL;
+	return &conn->send_queue;
+}
+
+// incoming バイトを追加してよいか確認する（送信キューのロックを保持して呼ぶ）
+// 空 → 非空 になる時だけ、担当スレッドのイベントループに書き込み監視を登録する
+bool Server::reserveSendQueue(int client_fd, SendQueue &queue, size_t incoming)
+{
+	if (incoming == 0)
+		return false;
+	Client *client = getClient(client_fd);
+
+	// hard 上限を超える場合は読まないクライアントとみなして切断する
+	if ((_config.sendq_hard_bytes && queue.bytes() + incoming > _config.sendq_hard_bytes) ||
+		(_config.sendq_hard_msgs && queue.messages() + 1 > _config.sendq_hard_msgs))
 	{
-		_send_buffers[client_fd] += message; // クライアントの送信バッファにメッセージを追加
+		_sendq_dropped_bytes += queue.dropUnsent() + incoming; //-> 送信途中の行は最後まで送ってから ERROR
+		_sendq_disconnects++;
+		queue.push(RPL_CLOSINGLINK(client->getIpAdd(), std::string("Max SendQ exceeded")));
+		LOG_WARN(RED << "Client <" << client_fd << "> Max SendQ exceeded" << WHI);
+		clearClients(client_fd);
+		return false;
 	}
+	// soft 上限を超える場合はこのメッセージだけ破棄する
+	if ((_config.sendq_soft_bytes && queue.bytes() + incoming > _config.sendq_soft_bytes) ||
+		(_config.sendq_soft_msgs && queue.messages() + 1 > _config.sendq_soft_msgs))
+	{
+		_sendq_dropped_bytes += incoming;
+		return false;
+	}
+	if (queue.empty())
+		armWrite(client_fd);
+	return true;
+}
+
+// 送信キューが空でなくなった fd の書き込み監視を登録する（_registry_lock を保持して呼ぶ）
+// PollLoop は担当スレッド以外から触れないので、別スレッドの担当なら頼んでから起こす
+void Server::armWrite(int client_fd)
+{
+	Worker *owner = _connections.find(client_fd)->owner;
+	if (pthread_equal(owner->thread, pthread_self()))
+	{
+		owner->loop->modify(client_fd, EVENT_READ | EVENT_WRITE | EVENT_EDGE);
+		return;
+	}
+	owner->armed.push_back(client_fd);
+	wakeWorker(*owner);
 }
 
-std::string Server::getSendBuffer(int client_fd) const
+// 他スレッドに頼まれた書き込み監視を登録する（_registry_lock を保持して呼ぶ）
+// 頼まれた後に切断された fd は飛ばす（再利用されていれば担当も変わっている）
+void Server::armRequestedWrites(Worker &worker)
 {
-	// クライアントの送信バッファを取得
-	std::map<int, std::string>::const_iterator it = _send_buffers.find(client_fd);
-	if (it != _send_buffers.end())
+	for (size_t i = 0; i < worker.armed.size(); i++)
 	{
-		return it->second; // クライアントの送信バッファを返す
+		Connection *conn = getConnection(worker, worker.armed[i]);
+		if (conn && conn->client)
+			worker.loop->modify(conn->fd, EVENT_READ | EVENT_WRITE | EVENT_EDGE);
 	}
-	return ""; // バッファが存在しない場合は空文字列を返す
+	worker.armed.clear();
 }
 
 std::string Server::_welcomemsg(void)
@@ -489,4 +1160,25 @@ std::string Server::_welcomemsg(void)
 	welcome.append("You need to login so you can start chatting OR you can send HELP to see how :) \n");
 	welcome.append(RESET);
 	return (welcome);
-};
\ No newline at end of file
+};
+// 登録完了時に送る 002〜005 は宛先のニックネーム以外は変わらないので、起動時に 1 度だけ整形する
+void Server::buildReplyCache(struct tm *timeinfo)
+{
+	char created[64];
+	if (strftime(created, sizeof(created), "%a %b %d %H:%M:%S %Y", timeinfo) == 0)
+		created[0] = '\0';
+	_created = created;
+
+	const std::string nick = REPLY_NICK_MARKER;
+	_burst.clear();
+	_burst.push_back(ReplyTemplate(RPL_YOURHOST(nick, "localhost", "ft_irc")));
+	_burst.push_back(ReplyTemplate(RPL_CREATED(nick, _created)));
+	_burst.push_back(ReplyTemplate(RPL_MYINFO(nick, "localhost", "ft_irc", "", "", "")));
+	_burst.push_back(ReplyTemplate(RPL_ISUPPORT(nick, "CASEMAPPING=rfc1459 CHANTYPES=#& NICKLEN=9 CHANMODES=,k,l,it PREFIX=(o)@")));
+}
+
+void Server::appendRegistrationBurst(Reply &reply, const std::string &nick) const
+{
+	for (size_t i = 0; i < _burst.size(); i++)
+		reply.format(_burst[i], nick);
+}
@@ -0,0 +1,179 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   trace.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/16 16:08:52 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/16 16:08:52 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "trace.hpp"
+#include "command.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+
+const char *tracePhaseName(TracePhase phase)
+{
+    static const char *names[PHASE_COUNT] = {"wait", "accept", "read", "dispatch", "flush", "reap", "other"};
+    return (phase < PHASE_COUNT) ? names[phase] : "unknown";
+}
+
+// TraceFile
+
+static void writeAll(int fd, const char *data, size_t size)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t n = write(fd, data + done, size - done);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return; //-> 書けなければ捨てる（トレースのためにサーバーを止めない）
+        done += n;
+    }
+}
+
+TraceFile::TraceFile() : _fd(-1), _first(true) {}
+
+TraceFile::~TraceFile()
+{
+    close();
+}
+
+void TraceFile::open(const std::string &path)
+{
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (_fd == -1)
+        throw(std::runtime_error("cannot open trace file: " + path));
+    _first = true;
+    writeAll(_fd, "[\n", 2);
+}
+
+void TraceFile::close()
+{
+    if (_fd == -1)
+        return;
+    writeAll(_fd, "\n]\n", 3);
+    ::close(_fd);
+    _fd = -1;
+}
+
+void TraceFile::append(std::string &events)
+{
+    ScopedLock lock(_lock);
+    if (_fd == -1 || events.empty())
+    {
+        events.clear();
+        return;
+    }
+    //-> 各イベントは ",\n" で始まるので、ファイルの最初のイベントだけ区切りを外す
+    size_t offset = _first ? 2 : 0;
+    _first = false;
+    writeAll(_fd, events.data() + offset, events.size() - offset);
+    events.clear();
+}
+
+// LoopTrace
+
+LoopTrace::LoopTrace()
+    : worker(0), current(PHASE_WAIT), begin(0), last(0), events(0), commands(0), slowest(0), slowest_fd(-1),
+      slowest_client(0), slowest_command(CMD_NONE), slowest_size(0), file(NULL)
+{
+    memset(phase_time, 0, sizeof(phase_time));
+    slowest_nick[0] = '\0';
+}
+
+void LoopTrace::start()
+{
+    begin = getMonotonicNanos();
+    last = begin;
+    current = PHASE_WAIT;
+    memset(phase_time, 0, sizeof(phase_time));
+    events = 0;
+    commands = 0;
+    slowest = 0;
+    slowest_fd = -1;
+    slowest_size = 0;
+}
+
+unsigned long LoopTrace::mark(TracePhase next)
+{
+    unsigned long now = getMonotonicNanos();
+    phase_time[current] += now - last;
+    last = now;
+    current = next;
+    return now;
+}
+
+unsigned long LoopTrace::busy() const
+{
+    return (last - begin) - phase_time[PHASE_WAIT];
+}
+
+// トレースの 1 イベント（complete event）。時刻は us 単位で書く
+static void appendSpan(std::string &out, const char *name, size_t tid, unsigned long start, unsigned long duration,
+                       const char *args)
+{
+    char event[384];
+    int len = snprintf(event, sizeof(event),
+                       ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}",
+                       name, static_cast<unsigned long>(tid), start / 1000.0, duration / 1000.0, args);
+    if (len > 0)
+        out.append(event, std::min(static_cast<size_t>(len), sizeof(event) - 1));
+}
+
+void LoopTrace::command(int fd, unsigned long client_id, const std::string &nick, CommandIndex index,
+                        const StringView &line, unsigned long start, unsigned long end)
+{
+    unsigned long elapsed = end - start;
+    commands++;
+    if (elapsed > slowest)
+    {
+        slowest = elapsed;
+        slowest_fd = fd;
+        slowest_client = client_id;
+        size_t nick_size = std::min(nick.size(), static_cast<size_t>(TRACE_NICK_MAX));
+        memcpy(slowest_nick, nick.data(), nick_size);
+        slowest_nick[nick_size] = '\0';
+        slowest_command = index;
+        slowest_size = std::min(line.size, static_cast<size_t>(TRACE_LINE_MAX));
+        memcpy(slowest_line, line.data, slowest_size);
+    }
+    if (file)
+    {
+        char args[64];
+        snprintf(args, sizeof(args), "\"fd\":%d,\"client\":%lu", fd, client_id);
+        appendSpan(pending, commandName(index), worker, start, elapsed, args);
+    }
+}
+
+void LoopTrace::finish()
+{
+    if (!file || (events == 0 && commands == 0))
+        return; //-> タイムアウトで起きただけの周回は書かない
+    unsigned long wait = phase_time[PHASE_WAIT];
+    appendSpan(pending, "wait", worker, begin, wait, "");
+    char args[256];
+    snprintf(args, sizeof(args),
+             "\"accept_us\":%lu,\"read_us\":%lu,\"dispatch_us\":%lu,\"flush_us\":%lu,\"reap_us\":%lu,"
+             "\"other_us\":%lu,\"events\":%lu,\"commands\":%lu",
+             phase_time[PHASE_ACCEPT] / 1000, phase_time[PHASE_READ] / 1000, phase_time[PHASE_DISPATCH] / 1000,
+             phase_time[PHASE_FLUSH] / 1000, phase_time[PHASE_REAP] / 1000, phase_time[PHASE_OTHER] / 1000,
+             static_cast<unsigned long>(events), static_cast<unsigned long>(commands));
+    appendSpan(pending, "loop", worker, begin + wait, busy(), args);
+    if (pending.size() >= TRACE_FLUSH_BYTES)
+        flush();
+}
+
+void LoopTrace::flush()
+{
+    if (file)
+        file->append(pending);
+}
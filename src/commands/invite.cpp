@@ -28,7 +28,7 @@ void invite(Server *server, int client_fd, ParsedMessage &msg)
     std::string channel_name = msg.params[1];
     if (channel_name[0] == '#' || channel_name[0] == '&')
         channel_name = channel_name.substr(1); // チャンネル名の先頭の # を削除
-    std::cout << "invite: " << target_nick << " to " << channel_name << std::endl;
+    LOG_DEBUG("invite: " << target_nick << " to " << channel_name);
     Channel *channel = server->getChannel(channel_name);
     if (!channel)
     {
@@ -43,7 +43,7 @@ void invite(Server *server, int client_fd, ParsedMessage &msg)
     }
 
     // チャンネルが招待制であり、クライアントがオペレーターでない場合はエラーを返す
-    if (channel->isInviteOnly() && !channel->isOperator(client->getNickname()))
+    if (channel->isInviteOnly() && !channel->isOperator(*client))
     {
         server->addToClientBuffer(client_fd, ERR_CHANOPRIVSNEEDED(client->getNickname(), channel_name));
         return; // オペレーターでない場合はエラーを返す
@@ -63,7 +63,7 @@ void invite(Server *server, int client_fd, ParsedMessage &msg)
     }
 
     // チャンネルの招待リストに対象ユーザーを追加
-    channel->addInvite(target_nick);
+    channel->addInvite(*target_client);
 
     // クライアントに成功メッセージを送信
     server->addToClientBuffer(client_fd, RPL_INVITING(client->getNickname(), client->getNickname(), target_nick, channel_name));
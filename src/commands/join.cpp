@@ -52,8 +52,8 @@ void join(Server *server, int client_fd, ParsedMessage &msg)
     if (msg.params[0] == "0")
     {
         // 引数が "0" の場合、全てのチャンネルからPARTする
-        const std::map<std::string, Channel *> &channels = client->getChannels();
-        for (std::map<std::string, Channel *>::const_iterator it = channels.begin(); it != channels.end();)
+        const Client::ChannelMap &channels = client->getChannels();
+        for (Client::ChannelMap::const_iterator it = channels.begin(); it != channels.end();)
         // for (const auto &pair : client->getChannels())
         {
             // Channel *channel = pair.second;
@@ -126,7 +126,7 @@ void join(Server *server, int client_fd, ParsedMessage &msg)
             }
         }
         // チャンネルのユーザー制限を確認
-        if (channel->getUserLimit() != -1 && channel->getClients().size() >= static_cast<size_t>(channel->getUserLimit()))
+        if (channel->getUserLimit() != -1 && channel->size() >= static_cast<size_t>(channel->getUserLimit()))
         {
             server->addToClientBuffer(client_fd, ERR_CHANNELISFULL(nick, channel_name));
             continue; // チャンネルが満員の場合はスキップ
@@ -138,7 +138,7 @@ void join(Server *server, int client_fd, ParsedMessage &msg)
         //     continue; // バンされている場合はスキップ
         // }
         // Invite-onlyモードのチャンネルに参加する場合、オペレーターからの招待が必要
-        if (channel->hasMode('i') && !channel->isInvited(nick))
+        if (channel->hasMode(CHANMODE_INVITE) && !channel->isInvited(*client))
         {
             server->addToClientBuffer(client_fd, ERR_INVITEONLYCHAN(nick, channel_name));
             continue; // 招待制のチャンネルに参加する場合はスキップ
@@ -146,9 +146,9 @@ void join(Server *server, int client_fd, ParsedMessage &msg)
 
         // JOIN処理
         channel->addClient(*client);
-        if (channel->getOperators().empty())
+        if (channel->getOperatorCount() == 0)
         {
-            channel->addOperator(nick); // 最初の参加者をオペレーターにする
+            channel->addOperator(*client); // 最初の参加者をオペレーターにする
         }
 
         // JOIN通知
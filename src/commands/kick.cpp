@@ -44,7 +44,7 @@ void kick(Server *server, int client_fd, ParsedMessage &msg)
         return; // クライアントがチャンネルに参加していない場合はエラーを返す
     }
 
-    if (!channel->isOperator(client->getNickname()))
+    if (!channel->isOperator(*client))
     {
         server->addToClientBuffer(client_fd, ERR_CHANOPRIVSNEEDED(client->getNickname(), channel_name));
         return; // オペレーターでない場合はエラーを返す
@@ -61,15 +61,11 @@ void kick(Server *server, int client_fd, ParsedMessage &msg)
     // std::string kick_message = ":" + client->getNickname() + " KICK " + channel_name + " " + target_nick + " :" + comment;
 
     // すべてのクライアントに通知（自分も含む）
-    std::map<std::string, Client *> members = channel->getClients();
-    for (std::map<std::string, Client *>::const_iterator it = members.begin(); it != members.end(); ++it)
-    {
-        server->addToClientBuffer(it->second->getFd(), RPL_KICK(client->getNickname(), channel_name, target_nick, comment));
-    }
+    channel->broadcast(server, RPL_KICK(client->getNickname(), channel_name, target_nick, comment));
 
-    if (channel->isOperator(target_nick))
+    if (channel->isOperator(*target_client))
     {
-        channel->removeOperator(target_nick); // 対象がオペレーターならオペレーターを削除
+        channel->removeOperator(*target_client); // 対象がオペレーターならオペレーターを削除
     }
     // 対象ユーザーをチャンネルから削除
     channel->removeClient(*target_client);
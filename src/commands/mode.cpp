@@ -19,8 +19,7 @@ static bool check_modeformat(const std::string &mode_str)
 
     for (size_t i = 1; i < mode_str.size(); ++i)
     {
-        if (mode_str[i] != 'i' && mode_str[i] != 'o' && mode_str[i] != 'k' &&
-            mode_str[i] != 'l' && mode_str[i] != 't')
+        if (!findChannelMode(mode_str[i]))
             return false; // モード文字列に不正な文字が含まれている場合は不正
     }
     return true; // 正常なモード文字列
@@ -38,7 +37,6 @@ static void modeChannel(Server *server, Client *client, ParsedMessage &msg)
         return; // チャンネルが存在しない場合はエラーを返す
     }
 
-    std::set<char> modes = channel->getModes();
     if (!channel->hasClient(*client))
     {
         server->addToClientBuffer(client->getFd(), ERR_NOTONCHANNEL(client->getNickname(), channel_name));
@@ -47,19 +45,12 @@ static void modeChannel(Server *server, Client *client, ParsedMessage &msg)
 
     if (msg.params.size() == 1)
     {
-        // 現在のモード表示
-        if (channel->getModes().empty())
-            server->addToClientBuffer(client->getFd(), RPL_CHANNELMODEIS(client->getNickname(), channel_name, ""));
-        else
-        {
-
-            std::string modes_msg = "+" + std::string(modes.begin(), modes.end());
-            server->addToClientBuffer(client->getFd(), RPL_CHANNELMODEIS(client->getNickname(), channel_name, modes_msg));
-        }
+        // 現在のモード表示（モード文字列は変更時に作ってあるものを使う）
+        server->addToClientBuffer(client->getFd(), RPL_CHANNELMODEIS(client->getNickname(), channel_name, channel->getModeString()));
         return; // モードが設定されていない場合はメッセージを返す
     }
 
-    if (!channel->isOperator(client->getNickname()))
+    if (!channel->isOperator(*client))
     {
         server->addToClientBuffer(client->getFd(), ERR_CHANOPRIVSNEEDED(client->getNickname(), channel_name));
         return; // オペレーターでない場合はエラーを返す
@@ -84,57 +75,58 @@ static void modeChannel(Server *server, Client *client, ParsedMessage &msg)
         else
         {
             char mode = mode_str[i];
-            if (mode == 'k' || mode == 'l' || mode == 'o')
+            const ModeInfo *info = findChannelMode(mode);
+            // 引数を取るかどうかはモード表（param_on_set / param_on_unset）で決める
+            std::string param;
+            if (add_mode ? info->param_on_set : info->param_on_unset)
             {
-                if (add_mode)
+                if (param_index >= msg.params.size())
                 {
-                    if (param_index >= msg.params.size())
-                    {
-                        server->addToClientBuffer(client->getFd(), ERR_NEEDMOREPARAMS(client->getNickname(), "MODE"));
-                        continue;
-                    }
-                    std::string param = msg.params[param_index++];
-                    if (mode == 'k')
-                        channel->setPassword(param);
-                    else if (mode == 'l')
-                    {
-                        int limit;
-                        std::istringstream iss(param);
-                        if (!(iss >> limit) || limit < 0)
-                        {
-                            server->addToClientBuffer(client->getFd(), ERR_INVALIDMODEPARAM(client->getNickname(), channel_name, "l", param));
-                            continue; // 無効な数値の場合はエラーを返す
-                        }
-                        channel->setUserLimit(limit);
-                    }
-                    else if (mode == 'o')
-                        channel->addOperator(param);
+                    server->addToClientBuffer(client->getFd(), ERR_NEEDMOREPARAMS(client->getNickname(), "MODE"));
+                    continue;
                 }
+                param = msg.params[param_index++];
+            }
+            if (mode == 'k')
+            {
+                if (add_mode)
+                    channel->setPassword(param);
                 else
+                    channel->removePassword();
+            }
+            else if (mode == 'l')
+            {
+                if (add_mode)
                 {
-                    if (mode == 'k')
-                        channel->removePassword();
-                    else if (mode == 'l')
-                        channel->setUserLimit(-1); // 制限なしに設定
-                    else if (mode == 'o')
+                    int limit;
+                    std::istringstream iss(param);
+                    if (!(iss >> limit) || limit < 0)
                     {
-                        if (param_index >= msg.params.size())
-                        {
-                            server->addToClientBuffer(client->getFd(), ERR_NEEDMOREPARAMS(client->getNickname(), "MODE"));
-                            continue;
-                        }
-                        std::string param = msg.params[param_index++];
-                        channel->removeOperator(param);
+                        server->addToClientBuffer(client->getFd(), ERR_INVALIDMODEPARAM(client->getNickname(), channel_name, "l", param));
+                        continue; // 無効な数値の場合はエラーを返す
                     }
+                    channel->setUserLimit(limit);
                 }
+                else
+                    channel->setUserLimit(-1); // 制限なしに設定
             }
-            else if (mode == 'i' || mode == 't')
+            else if (mode == 'o')
             {
+                Client *target = server->getClientByNickname(param);
+                if (!target || !channel->hasClient(*target))
+                {
+                    server->addToClientBuffer(client->getFd(), ERR_USERNOTINCHANNEL(client->getNickname(), param, channel_name));
+                    continue; // チャンネルにいないユーザーはオペレーターにできない
+                }
                 if (add_mode)
-                    channel->addMode(mode);
+                    channel->addOperator(*target);
                 else
-                    channel->removeMode(mode);
+                    channel->removeOperator(*target);
             }
+            else if (add_mode)
+                channel->addMode(info->bit);
+            else
+                channel->removeMode(info->bit);
         }
     }
 
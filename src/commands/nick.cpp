@@ -14,21 +14,6 @@
 
 // NICK コマンドの実装
 
-// クライアントのニックネームが使用中かどうかを確認する
-static bool isNicknameInUse(Server *server, std::string &nickname)
-{
-    std::map<int, Client *> clients = server->getClients();
-    for (std::map<int, Client *>::const_iterator it = clients.begin(); it != clients.end(); ++it)
-    // for (const Client &client : server->getClients()) //使えない（C++11)
-    {
-        if (it->second->getNickname() == nickname)
-        {
-            return true; // ニックネームが使用中
-        }
-    }
-    return false; // 使用中ではない
-}
-
 // ニックネームが有効かどうかを確認する
 static bool isValidNickname(const std::string &nickname)
 {
@@ -89,15 +74,13 @@ void nick(Server *server, int client_fd, ParsedMessage &msg)
         server->addToClientBuffer(client_fd, ERR_ERRONEUSNICKNAME(client->getNickname(), new_nick));
         return;
     }
-    // すでに使用されているニックネームかどうかを確認
-    if (isNicknameInUse(server, new_nick))
+    // 既存のニックネームを更新（すでに使用されている場合はエラー）
+    std::string old_nick = client->getNickname();
+    if (!server->setClientNickname(client, new_nick))
     {
         server->addToClientBuffer(client_fd, ERR_NICKNAMEINUSE(client->getNickname(), new_nick));
         return;
     }
-    // 既存のニックネームを更新
-    std::string old_nick = client->getNickname();
-    client->setNickname(new_nick);
 
     // クライアントの登録情報を更新
     if (!client->hasNick())
@@ -108,14 +91,17 @@ void nick(Server *server, int client_fd, ParsedMessage &msg)
     // NICK コマンドの応答を送信
     server->addToClientBuffer(client_fd, RPL_NICK(old_nick, client->getUsername(), new_nick));
     // チャンネル内の全クライアントに新しいニックネームを通知
-    std::map<std::string, Channel *> channels = client->getChannels();
+    const Client::ChannelMap &channels = client->getChannels();
     if (channels.empty())
     {
         return; // クライアントが参加しているチャンネルがない場合は何もしない
     }
-    // チャンネルごとにクライアントに新しいニックネームを通知
+    // 同じ相手が複数のチャンネルにいても通知は 1 回だけにする（本人には上で送信済み）
+    std::set<int> notified;
+    notified.insert(client_fd);
+    SharedMessage *shared = SharedMessage::create(RPL_NICK(old_nick, client->getUsername(), new_nick));
     // for (Channel *channel : client->getChannels())
-    for (std::map<std::string, Channel *>::const_iterator it = channels.begin(); it != channels.end(); ++it)
+    for (Client::ChannelMap::const_iterator it = channels.begin(); it != channels.end(); ++it)
     {
         Channel *channel = it->second;
         if (!channel->hasClient(*client))
@@ -123,9 +109,13 @@ void nick(Server *server, int client_fd, ParsedMessage &msg)
             continue; // クライアントがチャンネルに参加していない場合はスキップ
         }
 
-        // チャンネル内の全クライアントに新しいニックネームを通知
-        // std::string nick_change_message = ":" + old_nick + " NICK " + new_nick;
-        // channel->broadcast(server, nick_change_message);
-        channel->broadcast(server, RPL_NICK(old_nick, client->getUsername(), new_nick));
+        // メンバーは id で管理しているので、名前が変わった後でもそのまま引ける
+        const std::vector<ChannelMember> &members = channel->getMembers();
+        for (std::vector<ChannelMember>::const_iterator member = members.begin(); member != members.end(); ++member)
+        {
+            if (notified.insert(member->client->getFd()).second)
+                server->addToClientBuffer(member->client->getFd(), shared);
+        }
     }
+    shared->release();
 }
\ No newline at end of file
@@ -72,18 +72,14 @@ void part(Server *server, int client_fd, ParsedMessage &msg)
         // }
 
         // すべてのクライアントに通知（自分も含む）
-        const std::map<std::string, Client *> members = channel->getClients();
-        for (std::map<std::string, Client *>::const_iterator it = members.begin(); it != members.end(); ++it)
-        {
-            server->addToClientBuffer(it->second->getFd(), RPL_PART(client->getNickname(), channel_name, part_msg));
-        }
+        channel->broadcast(server, RPL_PART(client->getNickname(), channel_name, part_msg));
 
-        channel->removeOperator(client->getNickname()); // オペレーターからも削除
+        channel->removeOperator(*client); // オペレーターからも削除
+        // クライアントをチャンネルから削除
+        channel->removeClient(*client);
         if (channel->empty())
         {
-            server->removeChannel(channel_name); // チャンネルが空になったら削除
+            server->removeChannel(channel_name); // チャンネルが空になったら削除（channel はここで解放される）
         }
-        // クライアントをチャンネルから削除
-        channel->removeClient(*client);
     }
 }
\ No newline at end of file
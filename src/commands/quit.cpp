@@ -23,12 +23,16 @@ void quit(Server *server, int client_fd, ParsedMessage &msg)
     std::string quit_msg = msg.trailing.empty() ? "Client Quit" : msg.trailing;
     // std::string quit_message = ":" + client->getNickname() + " QUIT :" + quit_msg;
 
-    const std::map<int, Client *> &clients = server->getClients();
-    for (std::map<int, Client *>::const_iterator it = clients.begin(); it != clients.end(); ++it)
+    // 全員に同じ行を送るので共有メッセージを 1 つだけ作る
+    SharedMessage *quit_message = SharedMessage::create(RPL_QUIT(client->getNickname(), quit_msg));
+    for (int fd = 0; fd < server->getFdLimit(); fd++)
     {
         // クライアントにメッセージを送信
-        server->addToClientBuffer(it->second->getFd(), RPL_QUIT(client->getNickname(), quit_msg));
+        if (server->getClient(fd))
+            server->addToClientBuffer(fd, quit_message);
     }
+    quit_message->release();
+    client->getQuitStatus() = true; //-> 切断時にチャンネルへ PART を送らない
     // // クライアントが参加しているチャンネルからクライアントを削除
     // const std::map<std::string, Channel *> &channels = client->getChannels();
     // for (std::map<std::string, Channel *>::const_iterator it = channels.begin(); it != channels.end(); ++it)
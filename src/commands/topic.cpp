@@ -65,7 +65,7 @@ void topic(Server *server, int client_fd, ParsedMessage &msg)
             return; // クライアントがチャンネルに参加していない場合はエラーを返す
         }
         // トピックを設定 (check if user is operator when topic mode is set)
-        if (channel->hasMode('t') && !channel->isOperator(client->getNickname()))
+        if (channel->hasMode(CHANMODE_TOPIC) && !channel->isOperator(*client))
         {
             server->addToClientBuffer(client_fd, ERR_CHANOPRIVSNEEDED(client->getNickname(), channel_name));
             return; // オペレーターでない場合はエラーを返す
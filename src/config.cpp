@@ -0,0 +1,141 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   config.cpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/06 14:40:02 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/06 14:40:02 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "config.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cerrno>
+
+#define DEFAULT_SENDQ_HARD_BYTES (1024 * 1024) //-> 1 MiB
+#define MAX_THREADS 64
+#define DEFAULT_FLOOD_BURST 10
+#define DEFAULT_LINE_QUOTA 16
+#define DEFAULT_STALL_BUDGET_MS 100
+#define MAX_FLOOD_RATE 1000000 //-> 1 トークン 1 マイクロ秒が下限
+
+ServerConfig::ServerConfig()
+    : backend(""), sendq_soft_bytes(0), sendq_hard_bytes(DEFAULT_SENDQ_HARD_BYTES),
+      sendq_soft_msgs(0), sendq_hard_msgs(0), threads(1), accept_rate(0), accept_ip_rate(0),
+      flood_rate(0), flood_burst(DEFAULT_FLOOD_BURST), line_quota(DEFAULT_LINE_QUOTA),
+      metrics_port(0), metrics_socket(""), stall_budget_ms(DEFAULT_STALL_BUDGET_MS), trace_file(""),
+      log_level(LOG_LEVEL_INFO) {}
+
+// 0 以上の整数値を読み取る
+static size_t parseSize(const std::string &option, const std::string &value)
+{
+    char *end = NULL;
+    if (value.empty() || value[0] == '-')
+        throw std::runtime_error("Invalid value for " + option + ": " + value);
+    errno = 0;
+    unsigned long n = std::strtoul(value.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE)
+        throw std::runtime_error("Invalid value for " + option + ": " + value);
+    return static_cast<size_t>(n);
+}
+
+void parseServerOptions(int argc, char **argv, int first, ServerConfig &config)
+{
+    for (int i = first; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for option: " + option);
+        std::string value = argv[++i];
+
+        if (option == "--backend")
+            config.backend = value;
+        else if (option == "--sendq-soft")
+            config.sendq_soft_bytes = parseSize(option, value);
+        else if (option == "--sendq-hard")
+            config.sendq_hard_bytes = parseSize(option, value);
+        else if (option == "--sendq-soft-msgs")
+            config.sendq_soft_msgs = parseSize(option, value);
+        else if (option == "--sendq-hard-msgs")
+            config.sendq_hard_msgs = parseSize(option, value);
+        else if (option == "--threads")
+        {
+            config.threads = parseSize(option, value);
+            if (config.threads < 1 || config.threads > MAX_THREADS)
+                throw std::runtime_error("Invalid value for " + option + ": " + value);
+        }
+        else if (option == "--accept-rate")
+            config.accept_rate = parseSize(option, value);
+        else if (option == "--accept-rate-ip")
+            config.accept_ip_rate = parseSize(option, value);
+        else if (option == "--flood-rate")
+        {
+            config.flood_rate = parseSize(option, value);
+            if (config.flood_rate > MAX_FLOOD_RATE)
+                throw std::runtime_error("Invalid value for " + option + ": " + value);
+        }
+        else if (option == "--flood-burst")
+        {
+            config.flood_burst = parseSize(option, value);
+            if (config.flood_burst < 1)
+                throw std::runtime_error("Invalid value for " + option + ": " + value);
+        }
+        else if (option == "--line-quota")
+            config.line_quota = parseSize(option, value);
+        else if (option == "--metrics-port")
+        {
+            config.metrics_port = parseSize(option, value);
+            if (config.metrics_port < 1 || config.metrics_port > 65535)
+                throw std::runtime_error("Invalid value for " + option + ": " + value);
+        }
+        else if (option == "--stall-budget")
+            config.stall_budget_ms = parseSize(option, value);
+        else if (option == "--trace-file")
+        {
+            if (value.empty())
+                throw std::runtime_error("Invalid value for " + option + ": " + value);
+            config.trace_file = value;
+        }
+        else if (option == "--log-level")
+        {
+            if (!Logger::parseLevel(value, config.log_level))
+                throw std::runtime_error("Invalid value for " + option + ": " + value);
+        }
+        else if (option == "--metrics-socket")
+        {
+            if (value.empty())
+                throw std::runtime_error("Invalid value for " + option + ": " + value);
+            config.metrics_socket = value;
+        }
+        else
+            throw std::runtime_error("Unknown option: " + option);
+    }
+    if (config.metrics_port && !config.metrics_socket.empty())
+        throw std::runtime_error("Use either --metrics-port or --metrics-socket, not both");
+}
+
+void printServerUsage()
+{
+    std::cout << "Correct usage is ./ircserv [port] [password] [options] :)" << std::endl;
+    std::cout << "  --backend epoll|poll     event loop implementation" << std::endl;
+    std::cout << "  --sendq-soft BYTES       drop messages above this send queue size (0 = off)" << std::endl;
+    std::cout << "  --sendq-hard BYTES       disconnect above this send queue size (0 = off)" << std::endl;
+    std::cout << "  --sendq-soft-msgs N      drop messages above N queued messages (0 = off)" << std::endl;
+    std::cout << "  --sendq-hard-msgs N      disconnect above N queued messages (0 = off)" << std::endl;
+    std::cout << "  --threads N              socket I/O threads; commands stay serialized (epoll only, 1-64)" << std::endl;
+    std::cout << "  --accept-rate N          accept at most N new connections per second (0 = off)" << std::endl;
+    std::cout << "  --accept-rate-ip N       accept at most N new connections per second per IP (0 = off)" << std::endl;
+    std::cout << "  --flood-rate N           process at most N commands per second per client (0 = off, max 1000000)" << std::endl;
+    std::cout << "  --flood-burst N          commands a client may send ahead of --flood-rate (default 10)" << std::endl;
+    std::cout << "  --line-quota N           lines processed per client per loop turn (default 16, 0 = off)" << std::endl;
+    std::cout << "  --metrics-port N         serve Prometheus metrics on 127.0.0.1:N" << std::endl;
+    std::cout << "  --metrics-socket PATH    serve Prometheus metrics on a UNIX socket" << std::endl;
+    std::cout << "  --stall-budget MS        log loop iterations busier than MS milliseconds (default 100, 0 = off)" << std::endl;
+    std::cout << "  --trace-file PATH        write a Chrome trace-event JSON of loop iterations and commands" << std::endl;
+    std::cout << "  --log-level LEVEL        debug|info|warn|error (default info; debug needs make DEBUG_LOG=1)" << std::endl;
+}
@@ -15,21 +15,37 @@
 int main(int argc, char **argv)
 {
 
-	if (argc == 3)
+	if (argc >= 3)
 	{
 		Server ser;
+		ServerConfig config;
 		time_t rawtime;
 		struct tm *timeinfo;
 
+		// ポートとパスワード以降の起動オプションを読み込む
+		try
+		{
+			parseServerOptions(argc, argv, 3, config);
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << e.what() << std::endl;
+			printServerUsage();
+			return (FAILURE);
+		}
+		ser.setConfig(config);
+
 		// 現在のローカル時刻を timeinfo に取得
 		time(&rawtime);
 		timeinfo = localtime(&rawtime);
 
 		try
 		{
+			Logger::start(config.log_level); //-> ログはここから書き出し用のスレッド経由になる
 			// SignalHandler を設定して、サーバーの初期化と起動を行う
 			signal(SIGINT, Server::signalHandler);		//-> catch the signal (ctrl + c)
 			signal(SIGQUIT, Server::signalHandler);		//-> catch the signal (ctrl + \)
+			signal(SIGPIPE, SIG_IGN);					//-> 切断済みソケットへの send で落ちないようにする
 			ser.serverInit(argv[1], argv[2], timeinfo); //-> initialize the server
 
 			// 設定ファイルからサーバーの設定を読み込む
@@ -39,14 +55,15 @@ int main(int argc, char **argv)
 		catch (const std::exception &e)
 		{
 			ser.closeFds(); // 全てのファイルディスクリプタを閉じる
-			std::cerr << e.what() << std::endl;
+			LOG_ERROR(e.what());
 		}
+		Logger::stop(); //-> 全スレッドが止まった後なので、残りを書き出して終わる
 		std::cout << "The Server Closed!" << std::endl;
 		return (SUCCESS);
 	}
 	else
 	{
-		std::cout << "Correct usage is ./ircserv [port] [password] :)" << std::endl;
+		printServerUsage();
 		return (FAILURE);
 	}
 }
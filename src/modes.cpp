@@ -0,0 +1,48 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   modes.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: sasano <shunkotkg0141@gmail.com>           +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/12 10:20:41 by sasano            #+#    #+#             */
+/*   Updated: 2025/08/12 10:20:41 by sasano           ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "modes.hpp"
+
+// チャンネルモード表（文字の昇順）
+static const ModeInfo g_channel_modes[] = {
+    {'i', CHANMODE_INVITE, false, false},
+    {'k', CHANMODE_KEY, true, false},
+    {'l', CHANMODE_LIMIT, true, false},
+    {'o', 0, true, true},
+    {'t', CHANMODE_TOPIC, false, false},
+};
+
+// 英字以外の文字や 2 文字が同じ bit を取り合うことがないかをコンパイル時に確認する
+typedef char mode_bit_check[(MODE_BIT('a') == 1 && MODE_BIT('Z') == (ModeMask)1 << 51 && MODE_BIT('#') == 0) ? 1 : -1];
+
+const ModeInfo *findChannelMode(char letter)
+{
+    for (size_t i = 0; i < sizeof(g_channel_modes) / sizeof(g_channel_modes[0]); ++i)
+    {
+        if (g_channel_modes[i].letter == letter)
+            return &g_channel_modes[i];
+    }
+    return NULL;
+}
+
+std::string modeMaskToString(ModeMask mask)
+{
+    if (mask == 0)
+        return "";
+    std::string str = "+";
+    for (int bit = 0; bit < 52; ++bit)
+    {
+        if (mask & ((ModeMask)1 << bit))
+            str += (char)(bit < 26 ? 'a' + bit : 'A' + bit - 26);
+    }
+    return str;
+}
@@ -16,208 +16,361 @@
 #include "client.hpp"
 #include "command.hpp"
 
-// 文字列 input を空白文字で分割し、vector にして返す。
-//  : より前の部分（コマンドやパラメータ）を解析するため
-static std::vector<std::string> split(const std::string &input)
+static bool isSpace(char c)
 {
-	if (input.empty())
-	{
-		return std::vector<std::string>(); // 空の文字列は空のベクターを返す
-	}
-	// input 文字列から 文字列ストリームを生成
-	std::stringstream ss(input);
-	std::string word;
-	std::vector<std::string> tokens;
-	// ストリームから空白（スペース、タブ、改行）で区切られた単語を読み取り、tokens ベクターに追加
-	while (ss >> word)
-	{
-		tokens.push_back(word);
-	}
-	return tokens;
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
 }
 
-// 受信したメッセージを解析して、コマンド名、引数、トレーリングメッセージを取得する
-// 例: :dan!d@localhost PRIVMSG #chan :Hello
-// raw はクライアントから受け取った1行のメッセージ
-static ParsedMessage parseMessage(const std::string &raw)
+static StringView makeView(const char *begin, const char *end)
 {
-	ParsedMessage msg;
-	std::string subster = raw;
-	if (raw.empty())
+	StringView view;
+	view.data = begin;
+	view.size = end - begin;
+	return view;
+}
+
+// 空白以外が続く 1 トークンを切り出し、p をトークンの直後へ進める
+static StringView nextToken(const char *&p, const char *end)
+{
+	const char *begin = p;
+	while (p < end && !isSpace(*p))
+		++p;
+	return makeView(begin, p);
+}
+
+static void skipSpaces(const char *&p, const char *end)
+{
+	while (p < end && isSpace(*p))
+		++p;
+}
+
+// 受信したメッセージを 1 回の走査で解析して、タグ、prefix、コマンド名、引数、トレーリングメッセージを取得する
+// 例: @time=2025-08-08T00:00:00Z :dan!d@localhost PRIVMSG #chan :Hello
+// 文字列のコピーやメモリ確保は行わず、各要素は line の中を指す
+// 引数はトレーリングも含めて MAX_PARAMS 個まで。最後の 1 個は ':' が無くても行の残り全体になる
+bool parseMessage(const StringView &line, MessageView &msg)
+{
+	const char *p = line.data;
+	const char *end = line.data + line.size;
+	StringView empty = makeView(p, p);
+
+	msg.tags = empty;
+	msg.prefix = empty;
+	msg.command = empty;
+	msg.param_count = 0;
+	msg.trailing = empty;
+	msg.has_trailing = false;
+
+	skipSpaces(p, end);
+	// IRCv3 タグの抽出
+	if (p < end && *p == '@')
 	{
-		return msg; // 空のメッセージはそのまま返す
+		++p;
+		msg.tags = nextToken(p, end);
+		skipSpaces(p, end);
 	}
 	// prefix の抽出
-	if (raw[0] == ':')
+	if (p < end && *p == ':')
 	{
-		size_t prefix_end = raw.find(' ');
-		if (prefix_end != std::string::npos)
+		++p;
+		msg.prefix = nextToken(p, end);
+		skipSpaces(p, end);
+	}
+	// コマンド名
+	msg.command = nextToken(p, end);
+	// 引数とトレーリング
+	while (true)
+	{
+		skipSpaces(p, end);
+		if (p >= end)
+			break;
+		if (*p == ':' || msg.param_count == MAX_PARAMS - 1)
 		{
-			msg.prefix = raw.substr(1, prefix_end - 1);
-			subster = raw.substr(prefix_end + 1);
+			msg.trailing = makeView(*p == ':' ? p + 1 : p, end);
+			msg.has_trailing = true;
+			break;
 		}
+		msg.params[msg.param_count++] = nextToken(p, end);
 	}
+	return msg.command.size > 0;
+}
+
+// ハンドラに渡すために文字列を持つ ParsedMessage を作る
+void materializeMessage(const MessageView &view, ParsedMessage &msg)
+{
+	msg.prefix.assign(view.prefix.data, view.prefix.size);
+	msg.command.assign(view.command.data, view.command.size);
+	msg.params.clear();
+	msg.params.reserve(view.param_count);
+	for (size_t i = 0; i < view.param_count; i++)
+		msg.params.push_back(viewToString(view.params[i]));
+	msg.trailing.assign(view.trailing.data, view.trailing.size);
+}
+
+bool viewEquals(const StringView &view, const char *str)
+{
+	size_t len = strlen(str);
+	return view.size == len && memcmp(view.data, str, len) == 0;
+}
+
+std::string viewToString(const StringView &view)
+{
+	return std::string(view.data, view.size);
+}
+
+// コマンド表
+// 登録前のコマンドと登録後のコマンドで同じ表を使う（並びは irc.hpp の CommandIndex と同じ）
+// penalty はサーバー側の負荷の目安: チャンネルの状態を変える・多くの人に届くコマンドほど重い
+static const CommandEntry g_commands[] = {
+	{"CAP", cap, CMD_BEFORE_REGISTRATION, 1},
+	{"INVITE", invite, CMD_AFTER_REGISTRATION, 2},
+	{"JOIN", join, CMD_AFTER_REGISTRATION, 2},
+	{"KICK", kick, CMD_AFTER_REGISTRATION, 2},
+	{"MODE", mode, CMD_AFTER_REGISTRATION, 2},
+	{"NICK", nick, CMD_BEFORE_REGISTRATION | CMD_AFTER_REGISTRATION, 2},
+	{"PART", part, CMD_AFTER_REGISTRATION, 1},
+	{"PASS", pass, CMD_BEFORE_REGISTRATION | CMD_AFTER_REGISTRATION, 1},
+	{"PING", ping, CMD_AFTER_REGISTRATION, 1},
+	{"PRIVMSG", privmsg, CMD_AFTER_REGISTRATION, 1},
+	{"QUIT", quit, CMD_AFTER_REGISTRATION, 1},
+	{"TOPIC", topic, CMD_AFTER_REGISTRATION, 2},
+	{"USER", user, CMD_BEFORE_REGISTRATION | CMD_AFTER_REGISTRATION, 1},
+};
+// 表と enum の並びがずれていたらコンパイルエラーにする
+typedef char command_table_size_check[(sizeof(g_commands) / sizeof(g_commands[0]) == CMD_NONE) ? 1 : -1];
+
+static char toUpper(char c)
+{
+	return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
 
-	// トレーリングの抽出
-	size_t pos = raw.find(" :"); // トレーリングメッセージの開始位置を探す
-	if (pos != std::string::npos)
+// 長さ・先頭文字・末尾文字だけで候補を 1 つに絞る
+// コマンドを追加したらここにも case を足すこと
+static CommandIndex commandCandidate(const StringView &verb)
+{
+	if (verb.size < 3 || verb.size > 7)
+		return CMD_NONE;
+	char first = toUpper(verb.data[0]);
+	char last = toUpper(verb.data[verb.size - 1]);
+	switch (verb.size)
 	{
-		msg.trailing = subster.substr(pos + 2); // トレーリングメッセージ
-		subster = subster.substr(0, pos);		// トレーリングメッセージを除いた部分
+	case 3:
+		return (first == 'C') ? CMD_CAP : CMD_NONE;
+	case 4:
+		switch (first)
+		{
+		case 'J':
+			return CMD_JOIN;
+		case 'K':
+			return CMD_KICK;
+		case 'M':
+			return CMD_MODE;
+		case 'N':
+			return CMD_NICK;
+		case 'P':
+			if (last == 'T')
+				return CMD_PART;
+			if (last == 'S')
+				return CMD_PASS;
+			return (last == 'G') ? CMD_PING : CMD_NONE;
+		case 'Q':
+			return CMD_QUIT;
+		case 'U':
+			return CMD_USER;
+		}
+		return CMD_NONE;
+	case 5:
+		return (first == 'T') ? CMD_TOPIC : CMD_NONE;
+	case 6:
+		return (first == 'I') ? CMD_INVITE : CMD_NONE;
+	case 7:
+		return (first == 'P') ? CMD_PRIVMSG : CMD_NONE;
 	}
-	else
-		msg.trailing = ""; // トレーリングメッセージがない場合
-	// コマンド名と引数を分割
-	std::vector<std::string> tokens = split(subster);
-	if (!tokens.empty())
+	return CMD_NONE;
+}
+
+// RFC 2812 に従いコマンド名は大文字小文字を区別しない
+CommandIndex findCommandIndex(const StringView &verb)
+{
+	CommandIndex index = commandCandidate(verb);
+	if (index == CMD_NONE)
+		return CMD_NONE;
+	const char *name = g_commands[index].name;
+	for (size_t i = 0; i < verb.size; i++)
 	{
-		msg.command = tokens[0];
-		msg.params.assign(tokens.begin() + 1, tokens.end());
+		if (toUpper(verb.data[i]) != name[i])
+			return CMD_NONE;
 	}
+	return index;
+}
 
-	return msg;
+const CommandEntry *findCommand(const StringView &verb)
+{
+	CommandIndex index = findCommandIndex(verb);
+	return (index == CMD_NONE) ? NULL : &g_commands[index];
 }
 
-// コマンド実行処理
-void Server::executeCommand(ParsedMessage &msg, int client_fd)
+const char *commandName(CommandIndex index)
 {
-	if (msg.command.empty())
-		return;
+	return (index < CMD_NONE) ? g_commands[index].name : "unknown";
+}
+
+CommandIndex commandIndex(const CommandEntry *entry)
+{
+	return entry ? static_cast<CommandIndex>(entry - g_commands) : CMD_NONE;
+}
 
-	typedef void (*CommandFunc)(Server *, int, ParsedMessage &);
-	// コマンドを実行するための関数ポインタのマップ
-	static std::map<std::string, CommandFunc> commandMap;
-	if (commandMap.empty())
+// targets の [begin, end) と同じ宛先が、それより前に書かれているか
+static bool hasEarlierTarget(const StringView &targets, size_t begin, size_t end)
+{
+	size_t size = end - begin;
+	size_t i = 0;
+	while (i < begin)
 	{
-		commandMap["INVITE"] = invite;
-		commandMap["JOIN"] = join;
-		commandMap["KICK"] = kick;
-		// commandMap["KILL"] = kill;
-		// commandMap["LIST"] = list;
-		commandMap["MODE"] = mode;
-		// commandMap["MOTD"] = motd;
-		// commandMap["NAMES"] = names;
-		commandMap["NICK"] = nick;
-		// commandMap["NOTICE"] = notice;
-		// commandMap["OPER"] = oper;
-		commandMap["PART"] = part;
-		commandMap["PASS"] = pass;
-		commandMap["PING"] = ping;
-		commandMap["PRIVMSG"] = privmsg;
-		commandMap["QUIT"] = quit;
-		commandMap["TOPIC"] = topic;
-		commandMap["USER"] = user;
+		size_t j = i;
+		while (targets.data[j] != ',')
+			j++;
+		if (j - i == size && std::memcmp(targets.data + i, targets.data + begin, size) == 0)
+			return true;
+		i = j + 1;
 	}
+	return false;
+}
+
+unsigned int commandCost(const CommandEntry *entry, const MessageView &msg)
+{
+	if (!entry)
+		return 1; //-> 未知のコマンドもエラーを返す分だけ数える
+	unsigned int cost = entry->penalty;
+	// チャンネル宛ての PRIVMSG は全員に配られるので宛先チャンネルごとに 1 つ加える
+	// privmsg が配送するのは '#' のチャンネルだけで（'&' はニックネーム扱いで 401 になる）、
+	// 同じ宛先の重複も 1 回しか配らないので、それに合わせて数える
+	if (entry->func == privmsg && msg.param_count > 0)
+	{
+		const StringView &targets = msg.params[0];
+		size_t begin = 0;
+		while (begin < targets.size)
+		{
+			size_t end = begin;
+			while (end < targets.size && targets.data[end] != ',')
+				end++;
+			if (targets.data[begin] == '#' && !hasEarlierTarget(targets, begin, end))
+				cost++;
+			begin = end + 1;
+		}
+	}
+	return cost;
+}
+
+// コマンドが見つかった場合だけ文字列を持つ ParsedMessage を作って関数を呼び出す
+static void runCommand(Server *server, int client_fd, const CommandEntry *entry, const MessageView &view)
+{
+	ParsedMessage msg;
+	materializeMessage(view, msg);
+	msg.command = entry->name; // 小文字で送られてきても大文字に揃える
+	entry->func(server, client_fd, msg);
+}
+
+// コマンド実行処理
+void Server::executeCommand(const CommandEntry *entry, const MessageView &view, int client_fd)
+{
+	if (view.command.size == 0)
+		return;
 
 	Client *client = getClient(client_fd);
 	if (!client)
 	{
-		std::cout << "Client not found for fd: " << client_fd << std::endl;
+		LOG_DEBUG("Client not found for fd: " << client_fd);
 		return; // クライアントが見つからない場合は何もしない
 	}
 
-	// コマンドがマップに存在するか確認
-
-	std::map<std::string, CommandFunc>::const_iterator it = commandMap.find(msg.command);
-	if (it != commandMap.end())
+	// コマンドが表に存在するか確認
+	if (entry && (entry->flags & CMD_AFTER_REGISTRATION))
 	{
-		// コマンドが見つかった場合、対応する関数を呼び出す
-		it->second(this, client_fd, msg);
+		runCommand(this, client_fd, entry, view);
 	}
 	else
 	{
 		// 未知のコマンドに対するエラーメッセージ送信
-		addToClientBuffer(client_fd, ERR_UNKNOWNCOMMAND(client->getNickname(), msg.command));
+		addToClientBuffer(client_fd, ERR_UNKNOWNCOMMAND(client->getNickname(), viewToString(view.command)));
 	}
 }
 
-void Server::handleClientRegistrationCommand(std::map<int, Client *> &client, int client_fd, ParsedMessage &msg)
+void Server::handleClientRegistrationCommand(Client *client, int client_fd, const CommandEntry *entry, const MessageView &view)
 {
-	// クライアントの情報を取得
-	std::map<int, Client *>::iterator it = client.find(client_fd);
-	if (it == client.end())
+	if (!entry || !(entry->flags & CMD_BEFORE_REGISTRATION))
 	{
-		// クライアントが見つからない場合は何もしない
+		// 登録が完了していない状態での未知のコマンド
+		addToClientBuffer(client_fd, ERR_NOTREGISTERED(client->getNickname()));
+		LOG_DEBUG("Unknown command during registration: " << view.command);
 		return;
 	}
-	if (msg.command == "CAP")
-	{
-		cap(this, client_fd, msg);
-	}
-	else if (msg.command == "NICK")
-	{
-		nick(this, client_fd, msg);
-	}
-	else if (msg.command == "USER")
-	{
-		user(this, client_fd, msg);
-	}
-	else if (msg.command == "PASS")
+	runCommand(this, client_fd, entry, view);
+	if (entry->func == pass)
 	{
-		pass(this, client_fd, msg);
-		if (it->second->getPassFlag())
-			it->second->getConnexionPassword() = true; // パスワード接続フラグを立てる
+		if (client->getPassFlag())
+			client->getConnexionPassword() = true; // パスワード接続フラグを立てる
 		else
-			it->second->getConnexionPassword() = false; // パスワード接続フラグを下げる
-	}
-	else
-	{
-		// 登録が完了していない状態での未知のコマンド
-		addToClientBuffer(client_fd, ERR_NOTREGISTERED(it->second->getNickname()));
-		std::cout << "Unknown command during registration: " << msg.command << std::endl;
-		return;
+			client->getConnexionPassword() = false; // パスワード接続フラグを下げる
 	}
 }
 
-static void sendClientRegistration(Server *server, int client_fd, std::map<int, Client *>::iterator &it)
+static void sendClientRegistration(Server *server, int client_fd, Client *client)
 {
-	time_t now = time(NULL);
 	// クライアントに登録情報を送信
-	server->addToClientBuffer(client_fd, RPL_WELCOME(user_id(it->second->getNickname(), it->second->getUsername()), it->second->getNickname()));
-	server->addToClientBuffer(client_fd, RPL_YOURHOST(it->second->getNickname(), "localhost", "ft_irc"));
-	server->addToClientBuffer(client_fd, RPL_CREATED(it->second->getNickname(), static_cast<std::string>(ctime(&now)).substr(0, 24)));
-	server->addToClientBuffer(client_fd, RPL_MYINFO(it->second->getNickname(), "localhost", "ft_irc", "", "", ""));
-	std::cout << "Client registration complete for fd: " << client_fd << std::endl;
+	// 001 だけはユーザー名を含むので毎回組み立て、002〜005 は起動時に整形したものに宛先を埋める
+	const std::string &nick = client->getNickname();
+	Reply burst;
+	burst << RPL_WELCOME(user_id(nick, client->getUsername()), nick);
+	server->appendRegistrationBurst(burst, nick);
+	server->addToClientBuffer(client_fd, burst);
+	LOG_INFO("Client registration complete for fd: " << client_fd);
 }
 
 // クライアントからの1行を解析 -> コマンドを実行
-void Server::handleClientMessage(const std::string &line, int client_fd)
+// 計測用に、表で見つかったコマンド（無ければ CMD_NONE）を返す
+CommandIndex Server::handleClientMessage(const StringView &line, int client_fd)
 {
-	ParsedMessage msg = parseMessage(line);
-	if (msg.command.empty())
-		return; // コマンドが空の場合は何もしない
+	MessageView msg;
+	if (!parseMessage(line, msg))
+		return CMD_NONE; // コマンドが空の場合は何もしない
 
 	// クライアントの情報を取得
-	std::map<int, Client *>::iterator it = _clients.find(client_fd);
-	if (it == _clients.end())
+	Client *client = getClient(client_fd);
+	if (!client)
 	{
 		// クライアントが見つからない場合は何もしない
-		return;
+		return CMD_NONE;
 	}
 
-	std::cout << "Received command: " << msg.command << " from client fd: " << client_fd << std::endl;
+	// コマンド表は 1 行につき 1 回だけ引き、コスト計算・実行・計測で同じエントリを使う
+	const CommandEntry *entry = findCommand(msg.command);
+	chargeFlood(client, commandCost(entry, msg)); //-> 実行前に消費する（実行中に切断されても数え漏れない）
+
+	LOG_DEBUG("Received command: " << msg.command << " from client fd: " << client_fd);
 	// 登録が完了していない場合の処理（NICK/USERによる認証）
-	if (it->second->isRegistrationDone() == false)
+	if (client->isRegistrationDone() == false)
 	{
 		// クライアントの初期コマンドを処理
 		// クライアント情報収集中（NICKとUSERの取得）
-		// if (it->second.hasAllInfo() == false)
-		if (it->second->hasNick() == false || it->second->hasUser() == false)
+		// if (client.hasAllInfo() == false)
+		if (client->hasNick() == false || client->hasUser() == false)
 		{
 			// クライアントの初期コマンドを処理
 			// コマンドを解析して、NICK, USERコマンドによる情報をクライアント構造体に格納
-			handleClientRegistrationCommand(_clients, client_fd, msg);
+			handleClientRegistrationCommand(client, client_fd, entry, msg);
 		}
 		// 全情報取得後のWELCOME処理
 		// 情報がそろっていて WELCOME をまだ送っていなければ
-		if (it->second->hasNick() == true && it->second->hasUser() == true)
+		if (client->hasNick() == true && client->hasUser() == true)
 		{
 			// クライアントに登録情報を送信
 			// 001 〜 004 のサーバーメッセージを送信
-			sendClientRegistration(this, client_fd, it);
-			it->second->isRegistrationDone() = true; // 登録完了フラグを立てる
+			sendClientRegistration(this, client_fd, client);
+			client->isRegistrationDone() = true; // 登録完了フラグを立てる
 		}
 	}
 	else
-		executeCommand(msg, client_fd);
+		executeCommand(entry, msg, client_fd);
+	return commandIndex(entry);
 }
\ No newline at end of file
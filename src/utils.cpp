@@ -12,6 +12,8 @@
 
 #include "irc.hpp"
 
+#include <ctime>
+
 std::vector<std::string> split(const std::string &str, char delimiter)
 {
     std::vector<std::string> tokens;
@@ -26,4 +28,18 @@ std::vector<std::string> split(const std::string &str, char delimiter)
         }
     }
     return tokens;
-}
\ No newline at end of file
+}
+
+unsigned long getMonotonicMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long>(ts.tv_sec) * 1000000UL + ts.tv_nsec / 1000;
+}
+
+unsigned long getMonotonicNanos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long>(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
+}
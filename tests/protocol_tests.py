@@ -0,0 +1,745 @@
+#!/usr/bin/env python3
+"""
+IRC Server Protocol Tests
+Tests ft_irc server over raw sockets (no irssi / netcat needed)
+
+Each test starts its own server so that it can pass the options it needs.
+"""
+
+import json
+import os
+import re
+import shlex
+import signal
+import socket
+import struct
+import subprocess
+import tempfile
+import time
+from typing import Callable, List, Optional
+
+
+class IRCClient:
+    """Minimal line-based IRC client"""
+
+    def __init__(self, port: int, rcvbuf: int = 0):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        if rcvbuf:
+            # Must be set before connect() to shrink the TCP window
+            self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, rcvbuf)
+        self.sock.connect(("127.0.0.1", port))
+        self.buffer = b""
+        self.closed = False
+
+    def send(self, *lines: str):
+        self.sock.sendall(b"".join(line.encode() + b"\r\n" for line in lines))
+
+    def send_raw(self, data: str):
+        """Send bytes as they are (no line ending added)"""
+        self.sock.sendall(data.encode())
+
+    def register(self, password: str, nickname: str) -> str:
+        self.send(f"PASS {password}", f"NICK {nickname}", f"USER {nickname} 0 * :Test User")
+        output = self.read_until(" 004 ")
+        return output + self.read(0.1)  # 005 and anything else of the burst
+
+    def read(self, wait: float = 0.5) -> str:
+        """Read everything that arrives within `wait` seconds"""
+        end = time.time() + wait
+        while not self.closed and time.time() < end:
+            self.sock.settimeout(max(0.01, end - time.time()))
+            try:
+                data = self.sock.recv(65536)
+            except socket.timeout:
+                break
+            except ConnectionResetError:
+                data = b""
+            if not data:
+                self.closed = True
+                break
+            self.buffer += data
+        output, self.buffer = self.buffer.decode(errors="replace"), b""
+        return output
+
+    def read_until(self, text: str, timeout: float = 3.0) -> str:
+        """Read until `text` appears, the server closes, or `timeout` expires"""
+        output = ""
+        end = time.time() + timeout
+        while text not in output and not self.closed and time.time() < end:
+            output += self.read(0.1)
+        return output
+
+    def sync(self, token: str = "sync", timeout: float = 3.0) -> str:
+        """Read everything queued for this client so far (the PONG comes after it)"""
+        self.send(f"PING {token}")
+        return self.read_until(f"PONG localhost :{token}", timeout)
+
+    def close(self):
+        self.sock.close()
+
+
+def numbered(target: str, count: int, size: int = 0) -> List[str]:
+    """PRIVMSG lines to `target` whose text starts with a sequence number"""
+    return [f"PRIVMSG {target} :{i:05d} " + "x" * size for i in range(count)]
+
+
+def message_ids(output: str, target: str) -> List[int]:
+    """Sequence numbers (see numbered()) of the PRIVMSG to `target` found in `output`"""
+    return [int(match) for match in re.findall(rf"PRIVMSG {re.escape(target)} :(\d{{5}}) ", output)]
+
+
+def pongs(output: str) -> List[str]:
+    """Tokens of the PONG replies in `output`, in order"""
+    return re.findall(r"PONG localhost :(\S*)\r\n", output)
+
+
+def http_get(port: int, path: str) -> str:
+    """Plain HTTP/1.0 GET on 127.0.0.1, returning the whole response"""
+    with socket.create_connection(("127.0.0.1", port), timeout=3) as sock:
+        sock.sendall(f"GET {path} HTTP/1.0\r\nHost: localhost\r\n\r\n".encode())
+        response = b""
+        while True:
+            data = sock.recv(65536)
+            if not data:
+                return response.decode(errors="replace")
+            response += data
+
+
+def protocol_test(title: str, options=()):
+    """Mark a ProtocolTest method as a test with its own server.
+
+    `options` are the server options, or a function of the ProtocolTest that
+    returns them (for options that depend on the port). With None the test
+    starts and stops its servers itself.
+    """
+    def decorate(body: Callable[["ProtocolTest"], bool]):
+        def run(self: "ProtocolTest") -> bool:
+            print(f"Testing {title}...")
+            success = False
+            try:
+                if options is not None:
+                    if not self.start_server(options(self) if callable(options) else list(options)):
+                        return False
+                success = bool(body(self))
+            except (OSError, subprocess.SubprocessError, ValueError) as error:
+                print(f"  {type(error).__name__}: {error}")
+            finally:
+                self.stop_server()
+            print(f"{'✓' if success else '✗'} {title[0].upper() + title[1:]} test")
+            return success
+
+        run.__name__ = body.__name__
+        run.__doc__ = body.__doc__
+        run.protocol_test = True
+        return run
+    return decorate
+
+
+class ProtocolTest:
+    def __init__(self, server_binary: str = "./ircserv", port: int = 6667, password: str = "testpass",
+                 server_args: Optional[List[str]] = None):
+        self.server_binary = server_binary
+        self.port = port
+        self.password = password
+        self.server_args = server_args or []  # Appended to every server, e.g. --backend poll
+        self.server_process: Optional[subprocess.Popen] = None
+        self.clients: List[IRCClient] = []
+
+    def start_server(self, options: List[str] = [], stdout=subprocess.DEVNULL) -> bool:
+        """Start the IRC server with extra command line options"""
+        self.server_process = subprocess.Popen(
+            [self.server_binary, str(self.port), self.password] + options + self.server_args,
+            stdout=stdout,
+            stderr=subprocess.DEVNULL,
+            preexec_fn=os.setsid  # Create new process group
+        )
+        # Wait until the server accepts connections
+        for _ in range(50):
+            if self.server_process.poll() is not None:
+                print(f"✗ Server failed to start with options {options}")
+                return False
+            try:
+                socket.create_connection(("127.0.0.1", self.port), timeout=0.1).close()
+                return True
+            except OSError:
+                time.sleep(0.1)
+        print("✗ Server did not start listening")
+        return False
+
+    def stop_server(self, sig: int = signal.SIGTERM):
+        """Close the clients and stop the IRC server (SIGINT shuts it down cleanly)"""
+        for client in self.clients:
+            client.close()
+        self.clients = []
+        if self.server_process:
+            try:
+                os.killpg(os.getpgid(self.server_process.pid), sig)
+                self.server_process.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                os.killpg(os.getpgid(self.server_process.pid), signal.SIGKILL)
+                self.server_process.wait()
+            self.server_process = None
+
+    def client(self, nickname: Optional[str] = None, rcvbuf: int = 0) -> IRCClient:
+        """Connect a client, registering it when a nickname is given"""
+        client = IRCClient(self.port, rcvbuf)
+        self.clients.append(client)
+        if nickname:
+            client.register(self.password, nickname)
+        return client
+
+    def join(self, channel: str, *clients: IRCClient):
+        """JOIN the clients one by one, then drain what the others' JOINs sent them"""
+        for client in clients:
+            client.send(f"JOIN {channel}")
+            client.read_until(f"JOIN {channel}")
+        for client in clients:
+            client.sync()
+
+    @protocol_test("poll/epoll backend parity", options=None)
+    def test_backend_parity(self) -> bool:
+        """--backend poll and --backend epoll answer the same session identically"""
+        transcripts = []
+        for backend in ("poll", "epoll"):
+            if not self.start_server(["--backend", backend]):
+                return False
+            alice = self.client("alice")
+            bob = self.client("bob")
+            self.join("#parity", alice, bob)
+            alice.send("PRIVMSG #parity :to the channel", "PRIVMSG bob :to bob", "TOPIC #parity :new topic",
+                       "PRIVMSG nobody :lost")
+            transcripts.append((alice.sync(), bob.sync()))
+            self.stop_server()
+        alice_output, bob_output = transcripts[0]
+        return (transcripts[0] == transcripts[1] and "PRIVMSG #parity :to the channel" in bob_output
+                and "PRIVMSG bob :to bob" in bob_output and "new topic" in alice_output)
+
+    @protocol_test("abrupt disconnects")
+    def test_abrupt_disconnect(self) -> bool:
+        """Clients that vanish without QUIT are removed from their channels and free their nicknames"""
+        alice = self.client("alice")
+        peers = [self.client(f"peer{i}") for i in range(20)]
+        self.join("#drop", alice, *peers)
+        for i, peer in enumerate(peers):
+            if i % 2:
+                # Half of them with a RST instead of a FIN
+                peer.sock.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+            peer.close()
+        time.sleep(0.3)
+        output = alice.sync()
+        gone = [i for i in range(20) if re.search(rf"(?m)^:?peer{i}[! ]\S* ?(PART|QUIT) ", output)]
+        success = gone == list(range(20))
+        # The nicknames are free again and the channel keeps working
+        again = self.client()
+        success = success and " 001 " in again.register(self.password, "peer7")
+        self.join("#drop", again)
+        again.send("PRIVMSG #drop :back")
+        return success and "PRIVMSG #drop :back" in alice.read_until(":back")
+
+    @protocol_test("channel broadcast with a slow reader")
+    def test_broadcast_slow_reader(self) -> bool:
+        """A member that stops reading does not hold back or reorder the others' copies"""
+        slow = self.client("slow", rcvbuf=4096)
+        fast = [self.client(f"fast{i}") for i in range(3)]
+        sender = self.client("sender")
+        self.join("#wide", slow, sender, *fast)
+        sender.send(*numbered("#wide", 300, 200))
+        success = all(message_ids(client.read_until(":00299 ", 5), "#wide") == list(range(300))
+                      for client in fast)
+        # The slow reader gets every message as well, in order, once it reads
+        time.sleep(0.5)
+        return success and message_ids(slow.read_until(":00299 ", 5), "#wide") == list(range(300))
+
+    @protocol_test("ordered delivery to a small receive window")
+    def test_large_ordered_delivery(self) -> bool:
+        """Partial writes to a full socket neither lose, duplicate nor reorder lines"""
+        reader = self.client("reader", rcvbuf=4096)
+        writer = self.client("writer")
+        for chunk in range(20):
+            writer.send(*numbered("reader", 2000)[chunk * 100:(chunk + 1) * 100])
+            writer.read(0.01)  # The echo of its own messages
+        time.sleep(0.5)
+        output = reader.read_until(":01999 ", 10)
+        return message_ids(output, "reader") == list(range(2000)) and not writer.closed
+
+    @protocol_test("Max SendQ disconnect", ["--sendq-hard", "65536"])
+    def test_sendq_disconnect(self) -> bool:
+        """A client that stops reading is dropped with Max SendQ exceeded"""
+        # Small receive window so that the server side queue fills quickly
+        reader = self.client("reader", rcvbuf=4096)
+        writer = self.client("writer")
+        payload = "x" * 400
+        # Enough to fill the kernel socket buffers (up to a few MiB on loopback) as well
+        output = ""
+        for _ in range(1000):
+            writer.send(*[f"PRIVMSG reader :{payload}"] * 50)
+            # The writer gets its own messages echoed back (and 401 once the reader is gone),
+            # so it keeps reading to stay under the limit itself
+            output = output[-100:] + writer.read(0.01)
+            if "401 writer reader" in output:
+                break
+
+        # Everything still buffered in the kernel arrives first, then the ERROR line
+        output = reader.read_until("(Max SendQ exceeded)", timeout=10)
+        success = "ERROR :Closing Link:" in output and "(Max SendQ exceeded)" in output
+        # The writer must not be affected
+        return success and "PONG" in writer.sync()
+
+    @protocol_test("Max SendQ disconnect in the middle of a line", ["--sendq-hard", "8388608"])
+    def test_sendq_disconnect_mid_line(self) -> bool:
+        """A line that was partly written is finished before the ERROR line"""
+        reader = self.client("reader", rcvbuf=4096)
+        writer = self.client("writer")
+        line = "PRIVMSG reader :" + "x" * 1499
+
+        def flood(rounds: int):
+            output = ""
+            for _ in range(rounds):
+                writer.send(*[line] * 100)
+                output = output[-100:] + writer.read(0.005)
+                if "401 writer reader" in output:
+                    return
+
+        # Fill the kernel buffers (a few MiB on loopback) and queue more behind them
+        flood(40)
+        writer.sync()
+        # Drain part of it: the server then writes a large batch that the socket takes only partly,
+        # which usually stops in the middle of a line
+        received = b""
+        reader.sock.settimeout(3)
+        while len(received) < 2000000:
+            received += reader.sock.recv(65536)
+        # Stop reading again until the queue crosses the hard limit
+        flood(1000)
+        output = received.decode() + reader.read_until("never sent", timeout=10)
+
+        lines = output.split("\r\n")
+        errors = [i for i, text in enumerate(lines) if text.startswith("ERROR :Closing Link:")]
+        if len(errors) != 1 or lines[-1] != "":
+            return False
+        # Every line before the ERROR is a whole PRIVMSG (no cut-off line glued to the ERROR)
+        return all(re.fullmatch(rf"\S+ {line}", text) for text in lines[:errors[0]])
+
+    @protocol_test("split and coalesced lines")
+    def test_split_and_coalesced_lines(self) -> bool:
+        """Lines split over many reads or packed into one are framed the same way"""
+        alice = self.client("alice")
+        for piece in ["PI", "NG one\r", "\nPING two\r\nPI", "NG three\nPING four\n"]:
+            alice.send_raw(piece)
+            time.sleep(0.05)
+        return pongs(alice.read_until(":four")) == ["one", "two", "three", "four"]
+
+    @protocol_test("overlong line")
+    def test_overlong_line(self) -> bool:
+        """A line over the length limit is dropped whole, and the next line still works"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        # One write, so the whole line and the PING after it may arrive in a single recv
+        alice.send(f"PRIVMSG bob :{'x' * 12000}", "PING after", "PRIVMSG bob :short")
+        success = pongs(alice.read_until(":after")) == ["after"]
+        output = bob.sync()
+        return success and "xxxx" not in output and "PRIVMSG bob :short" in output
+
+    @protocol_test("message tags and prefix")
+    def test_message_tags_and_prefix(self) -> bool:
+        """IRCv3 tags, a client prefix and repeated spaces are parsed away"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        alice.send("@time=2024-01-01T00:00:00.000Z;msgid=42 :alice PRIVMSG bob :tagged hello",
+                   "PRIVMSG   bob   :spaced   out")
+        output = bob.sync()
+        return ("PRIVMSG bob :tagged hello" in output and "PRIVMSG bob :spaced   out" in output
+                and "msgid" not in output)
+
+    @protocol_test("fifteenth parameter")
+    def test_fifteenth_parameter(self) -> bool:
+        """The 15th parameter takes the rest of the line even without a ':'"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        fillers = " ".join(f"p{i}" for i in range(13))
+        alice.send(f"PRIVMSG bob {fillers} last :hello there")
+        return "PRIVMSG bob :last :hello there" in bob.sync()
+
+    @protocol_test("lowercase command dispatch")
+    def test_lowercase_command(self) -> bool:
+        """Command names are case-insensitive (privmsg is dispatched like PRIVMSG)"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        alice.send("privmsg bob :hello in lowercase")
+        success = "PRIVMSG bob :hello in lowercase" in bob.read_until("hello in lowercase")
+        alice.send("Ping mixed")
+        output = alice.read_until("PONG")
+        return success and "PONG" in output and " 421 " not in output
+
+    @protocol_test("rfc1459 nickname collisions")
+    def test_rfc1459_nick_collision(self) -> bool:
+        """Nicknames collide under rfc1459 casemapping ([]\\^ are the uppercase of {}|~)"""
+        self.client("Foo[")
+        other = self.client()
+        other.send(f"PASS {self.password}", "NICK foo{")
+        success = " 433 " in other.read_until(" 433 ")
+        other.send("NICK FOO{")
+        success = success and " 433 " in other.read_until(" 433 ")
+        # A nickname that only differs outside the casemapping is still free
+        other.send("NICK foo]x", "USER foo 0 * :Test User")
+        return success and " 001 " in other.read_until(" 001 ")
+
+    @protocol_test("case-only nickname change")
+    def test_nick_case_change(self) -> bool:
+        """NICK to the same name in another case keeps the index entry, a real rename frees it"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        alice.send("NICK Alice")
+        success = "NICK" in alice.read_until("Alice")
+        other = self.client()
+        other.send(f"PASS {self.password}", "NICK ALICE")
+        success = success and " 433 " in other.read_until(" 433 ")
+        bob.send("PRIVMSG alice :still you")
+        success = success and "still you" in alice.read_until("still you")
+        alice.send("NICK carol")
+        alice.read_until("carol")
+        other.send("NICK alice", "USER alice 0 * :Test User")
+        return success and " 001 " in other.read_until(" 001 ")
+
+    @protocol_test("INVITE and KICK")
+    def test_invite_kick(self) -> bool:
+        """An invite lets a user into a +i channel, a kick takes him out again"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        self.join("#priv", alice)
+        alice.send("MODE #priv +i")
+        alice.read_until("MODE #priv +i")
+        bob.send("JOIN #priv")
+        success = "Cannot join channel (+i)" in bob.read_until("(+i)")
+        alice.send("INVITE bob #priv")
+        success = success and "INVITE bob" in bob.read_until("INVITE")
+        self.join("#priv", bob)
+        alice.sync()
+        alice.send("KICK #priv bob :bye")
+        success = success and "KICK #priv bob" in bob.read_until("KICK")
+        # Channel messages no longer reach him
+        alice.send("PRIVMSG #priv :after the kick")
+        alice.sync()
+        return success and "after the kick" not in bob.sync()
+
+    @protocol_test("cross-thread PRIVMSG, JOIN and QUIT", ["--threads", "4"])
+    def test_threads_cross_worker(self) -> bool:
+        """With --threads 4 clients on different event loops still see each other"""
+        clients = [self.client(f"user{i}") for i in range(8)]  # Handed out round-robin
+        self.join("#threads", *clients)
+        for i, client in enumerate(clients):
+            client.send(f"PRIVMSG #threads :from {i}")
+        time.sleep(0.3)
+        success = True
+        for i, client in enumerate(clients):
+            output = client.sync()
+            success = success and all(f":from {j}\r\n" in output for j in range(8) if j != i)
+        clients[0].send("PRIVMSG user5 :direct")
+        success = success and "PRIVMSG user5 :direct" in clients[5].read_until(":direct")
+        clients[3].send("QUIT :leaving")
+        return success and all(re.search(r"(?m)^:?user3[! ]\S* ?QUIT ", clients[i].read_until("QUIT"))
+                               for i in (0, 1, 2, 4, 7))
+
+    @protocol_test("accept rate limits", options=None)
+    def test_accept_rate_limits(self) -> bool:
+        """--accept-rate and --accept-rate-ip refuse the connections over the limit"""
+        success = True
+        for option in ("--accept-rate", "--accept-rate-ip"):
+            if not self.start_server([option, "3"]):
+                return False
+            # Start right after a second boundary so that all connects fall into one window
+            time.sleep(1.05 - time.time() % 1)
+            clients = [self.client() for _ in range(6)]
+            outputs = [client.read(0.3) for client in clients]
+            refused = [i for i, output in enumerate(outputs) if "Connection rate exceeded" in output]
+            success = success and refused == [3, 4, 5] and all(clients[i].closed for i in refused)
+            success = success and " 001 " in clients[0].register(self.password, "alice")
+            # The next window accepts again
+            time.sleep(1.05 - time.time() % 1)
+            success = success and " 001 " in self.client().register(self.password, "bob")
+            self.stop_server()
+        return success
+
+    @protocol_test("welcome burst")
+    def test_welcome_burst(self) -> bool:
+        """Registration sends 001 to 005 in order, with the ISUPPORT tokens in 005"""
+        alice = self.client()
+        output = alice.register(self.password, "alice")
+        numerics = [line.split()[1] for line in output.split("\r\n") if line.startswith(":localhost 00")]
+        success = numerics == ["001", "002", "003", "004", "005"]
+        success = success and "CASEMAPPING=rfc1459" in output and "PREFIX=(o)@" in output
+        # Everything later goes to a registered client, not a second burst
+        return success and " 001 " not in alice.sync()
+
+    @protocol_test("flood control fake lag", ["--flood-rate", "20", "--flood-burst", "5"])
+    def test_flood_fake_lag(self) -> bool:
+        """Commands over --flood-rate are delayed (fake lag), not dropped or disconnected"""
+        alice = self.client("alice")
+        time.sleep(0.5)  # Refill the bucket used by registration
+        start = time.time()
+        alice.send(*[f"PING {i}" for i in range(40)])
+        early = alice.read(0.3).count("PONG")
+        output = alice.read_until("PONG localhost :39", timeout=5)
+        elapsed = time.time() - start
+        # 5 ahead of the rate at once, then 20 per second: 40 lines take about 1.75 s
+        return early < 20 and "PONG localhost :39" in output and elapsed > 1.2 and not alice.closed
+
+    @protocol_test("line quota fairness", ["--line-quota", "4"])
+    def test_line_quota_fairness(self) -> bool:
+        """--line-quota interleaves a busy client with others instead of draining it first"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        carol = self.client("carol")
+        self.join("#fair", alice, bob, carol)
+        # alice pipelines 3000 lines, bob sends one right after
+        alice.send(*numbered("#fair", 3000))
+        bob.send("PRIVMSG #fair :from bob")
+        output = carol.read_until(":02999 ", timeout=10)
+        lines = [line for line in output.split("\r\n") if "PRIVMSG #fair" in line]
+        position = [i for i, line in enumerate(lines) if line.endswith(":from bob")]
+        # Without the quota bob's line comes after all of alice's (position 3000)
+        return len(lines) == 3001 and len(position) == 1 and position[0] < 2000
+
+    @protocol_test("MODE +o on a non-member")
+    def test_mode_op_non_member(self) -> bool:
+        """MODE +o on a user outside the channel is refused with 441"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        self.join("#ops", alice)
+        alice.send("MODE #ops +o bob")
+        success = "441 alice bob #ops" in alice.read_until("441")
+        # bob joins afterwards as a normal member, not as an operator
+        self.join("#ops", bob)
+        bob.send("MODE #ops +t")
+        success = success and "482 bob #ops" in bob.read_until("482")
+        # Once he is a member the same MODE +o works
+        alice.send("MODE #ops +o bob")
+        bob.read_until("MODE #ops +o")
+        bob.send("MODE #ops +t")
+        return success and "MODE #ops +t" in bob.read_until("MODE #ops +t")
+
+    @protocol_test("channel mode query")
+    def test_mode_query(self) -> bool:
+        """MODE #channel reports exactly the modes set and cleared so far"""
+        alice = self.client("alice")
+        self.join("#modes", alice)
+
+        def modes() -> set:
+            alice.send("MODE #modes")
+            reply = re.search(r" 324 alice #modes \+(\S*)", alice.read_until(" 324 "))
+            return set(reply.group(1)) if reply else set()
+
+        alice.send("MODE #modes +i", "MODE #modes +k secret", "MODE #modes +l 5")
+        alice.sync()
+        success = modes() == {"i", "k", "l"}
+        alice.send("MODE #modes -i", "MODE #modes +t", "MODE #modes -k secret")
+        alice.sync()
+        return success and modes() == {"l", "t"}
+
+    @protocol_test("PART of the last member")
+    def test_part_frees_empty_channel(self) -> bool:
+        """The last PART destroys the channel: a new JOIN starts fresh with a new operator"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        alice.send("JOIN #tmp", "TOPIC #tmp :old topic", "MODE #tmp +k secret")
+        alice.read_until("MODE #tmp +k")
+        alice.send("PART #tmp")
+        alice.read_until("PART")
+        # No key, no topic, and bob is the operator of the new channel
+        bob.send("JOIN #tmp")
+        output = bob.read_until(" 331 ")
+        success = "JOIN #tmp" in output and " 331 " in output and "old topic" not in output
+        bob.send("MODE #tmp +t")
+        return success and "MODE #tmp +t" in bob.read_until("MODE #tmp +t")
+
+    @protocol_test("interleaved partial lines")
+    def test_interleaved_partial_lines(self) -> bool:
+        """Clients sending long lines in pieces, in turn, each get their own line back"""
+        clients = [self.client(f"frag{i}") for i in range(10)]
+        idle = [self.client() for _ in range(20)]  # Connected but silent: no receive buffer
+        lines = [f"PING part{i}-" + "y" * (100 + i * 700) for i in range(10)]  # Up to about 6 KiB
+        for piece in range(3):
+            for client, line in zip(clients, lines):
+                third = len(line) // 3
+                client.send_raw(line[piece * third:] + "\r\n" if piece == 2 else line[piece * third:(piece + 1) * third])
+            time.sleep(0.05)
+        success = all(pongs(client.read_until(f":part{i}-")) == [lines[i][5:]]
+                      for i, client in enumerate(clients))
+        return success and not any(client.closed for client in idle)
+
+    @protocol_test("many connections and fd reuse")
+    def test_many_connections(self) -> bool:
+        """Hundreds of clients, then new clients on reused descriptors start clean"""
+        clients = [self.client(f"c{i}") for i in range(300)]
+        for client in clients[::2]:
+            client.close()
+        time.sleep(0.3)
+        success = True
+        for i in range(0, 300, 2):
+            clients[i] = self.client()
+            output = clients[i].register(self.password, f"c{i}")
+            success = success and " 001 c" + str(i) + " " in output and " 433 " not in output
+        clients[299].send("PRIVMSG c0 :across the table")
+        return success and "across the table" in clients[0].read_until("across the table")
+
+    @protocol_test("QUIT without a trailing PART")
+    def test_quit_without_part(self) -> bool:
+        """Channel members see one QUIT and no PART, and a channel left empty is freed"""
+        alice = self.client("alice")
+        bob = self.client("bob")
+        self.join("#one", alice, bob)
+        self.join("#two", alice, bob)
+        self.join("#solo", alice)
+        alice.send("TOPIC #solo :old topic", "QUIT :bye")
+        alice.read_until("QUIT")
+        output = bob.read_until("QUIT") + bob.sync()
+        success = (len(re.findall(r"(?m)^:?alice[! ]\S* ?QUIT ", output)) == 1
+                   and not re.search(r"(?m)^:?alice[! ]\S* ?PART ", output))
+        # #solo went away with alice: joining it again starts without a topic
+        bob.send("JOIN #solo")
+        output = bob.read_until(" 331 ")
+        return success and " 331 " in output and "old topic" not in output
+
+    @protocol_test("ircbench load generator")
+    def test_ircbench(self) -> bool:
+        """A short ircbench run connects every client and sees no errors"""
+        bench = os.path.join(os.path.dirname(os.path.abspath(self.server_binary)), "ircbench")
+        if not os.path.exists(bench):
+            print("  ircbench is not built (make ircbench), skipped")
+            return True
+        result = subprocess.run([bench, "--port", str(self.port), "--password", self.password, "--clients", "50",
+                                 "--channels", "5", "--duration", "1", "--rate", "5"],
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=30)
+        output = result.stdout.decode(errors="replace")
+        delivered = re.search(r"delivered\s+(\d+) messages", output)
+        return (result.returncode == 0 and "connected 50/50 clients" in output and delivered is not None
+                and int(delivered.group(1)) > 0 and "0 numeric errors, 0 disconnects" in output)
+
+    @protocol_test("microbenchmarks", options=None)
+    def test_microbench(self) -> bool:
+        """Every built microbenchmark runs the sample corpus and reports ns/op"""
+        root = os.path.dirname(os.path.abspath(self.server_binary))
+        binaries = [os.path.join(root, "obj", "bench", f"micro_{name}")
+                    for name in ("parser", "framer", "dispatch", "split", "replies")]
+        binaries = [path for path in binaries if os.path.exists(path)]
+        if not binaries:
+            print("  microbenchmarks are not built (make microbench), skipped")
+            return True
+        corpus = os.path.join(root, "bench", "corpus", "client.txt")
+        for path in binaries:
+            result = subprocess.run([path, corpus], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=60)
+            if result.returncode != 0 or b"ns/op" not in result.stdout:
+                print(f"  {os.path.basename(path)} failed")
+                return False
+        return True
+
+    @protocol_test("metrics endpoint", lambda self: ["--metrics-port", str(self.port + 1)])
+    def test_metrics_endpoint(self) -> bool:
+        """GET /metrics on --metrics-port serves Prometheus text with exact counters"""
+        alice = self.client("alice")
+        alice.send(*["PING metrics"] * 7)
+        alice.read_until("PONG", timeout=1)
+        alice.send("JOIN #metrics")
+        alice.read_until("JOIN #metrics", timeout=1)
+        time.sleep(0.2)
+        response = http_get(self.port + 1, "/metrics")
+        success = response.startswith("HTTP/1.") and " 200 " in response.split("\r\n")[0]
+        success = success and "text/plain" in response
+        body = response.split("\r\n\r\n", 1)[-1]
+        success = success and 'ircserv_commands_total{command="PING"} 7\n' in body
+        success = success and "ircserv_clients 1\n" in body
+        success = success and "# TYPE ircserv_command_duration_seconds histogram" in body
+        success = success and 'ircserv_command_duration_seconds_count{command="PING"} 7\n' in body
+        success = success and 'ircserv_pool_objects{pool="Client"} 1\n' in body
+        success = success and 'ircserv_pool_objects{pool="Channel"} 1\n' in body
+        # alice's lines are all handled, so her receive buffer is back in the free list
+        lent = re.findall(r'ircserv_recv_buffers\{worker="\d+"\} (\d+)\n', body)
+        cached = re.findall(r'ircserv_recv_pool_cached_bytes\{worker="\d+"\} (\d+)\n', body)
+        success = success and lent and sum(map(int, lent)) == 0 and sum(map(int, cached)) >= 4096
+        return success and " 404 " in http_get(self.port + 1, "/nothing").split("\r\n")[0]
+
+    @protocol_test("log flush on shutdown", options=None)
+    def test_log_flush_on_shutdown(self) -> bool:
+        """Lines logged right before exit still reach stdout (the log thread drains its queue)"""
+        with tempfile.TemporaryFile() as log:
+            if not self.start_server([], stdout=log):
+                return False
+            alice = self.client("alice")
+            alice.send("QUIT :bye")
+            alice.read_until("QUIT")
+            self.stop_server(signal.SIGINT)
+            log.seek(0)
+            output = log.read().decode(errors="replace")
+        # The pool report is the last thing the server logs
+        return "Connected" in output and "Pool Client: in use 0 " in output and output.endswith("\n")
+
+    @protocol_test("stall log and trace file", options=None)
+    def test_stall_trace(self) -> bool:
+        """--stall-budget logs busy iterations and --trace-file is valid trace-event JSON"""
+        with tempfile.TemporaryDirectory() as directory, tempfile.TemporaryFile() as log:
+            trace = os.path.join(directory, "trace.json")
+            if not self.start_server(["--stall-budget", "1", "--trace-file", trace], stdout=log):
+                return False
+            clients = [self.client(f"busy{i}") for i in range(50)]
+            self.join("#busy", *clients)
+            # Every member fans out to 50 queues at once: far more than 1 ms of work per iteration
+            for client in clients:
+                client.send(*numbered("#busy", 20))
+            time.sleep(1)
+            self.stop_server(signal.SIGINT)
+            log.seek(0)
+            output = log.read().decode(errors="replace")
+            with open(trace) as file:
+                document = json.load(file)
+        events = document["traceEvents"] if isinstance(document, dict) else document
+        return ("Stall: worker" in output and len(events) > 0
+                and all(event.get("ph") and event.get("name") for event in events))
+
+    def run_all_tests(self, only: Optional[str] = None) -> bool:
+        """Run all tests (the ones whose name contains `only`, if given)"""
+        print("=" * 50)
+        print("Starting IRC Server Protocol Tests")
+        print("=" * 50)
+
+        tests = [getattr(self, name) for name, method in vars(ProtocolTest).items()
+                 if getattr(method, "protocol_test", False) and (not only or only in name)]
+
+        passed = 0
+        for test in tests:
+            if test():
+                passed += 1
+
+        print("=" * 50)
+        print(f"Tests completed: {passed}/{len(tests)} passed")
+        print("=" * 50)
+
+        return passed == len(tests)
+
+
+def main():
+    """Main test runner"""
+    import argparse
+
+    parser = argparse.ArgumentParser(description="IRC Server Protocol Tests")
+    parser.add_argument("--server", default="./ircserv", help="Path to IRC server binary")
+    parser.add_argument("--port", type=int, default=6667, help="Server port")
+    parser.add_argument("--password", default="testpass", help="Server password")
+    parser.add_argument("--server-args", default="", help="Options added to every server (e.g. \"--backend poll\")")
+    parser.add_argument("--only", help="Run only the tests whose name contains this")
+
+    args = parser.parse_args()
+
+    # Check if server binary exists
+    if not os.path.exists(args.server):
+        print(f"Error: Server binary '{args.server}' not found")
+        print("Please compile the server first with 'make'")
+        return 1
+
+    tester = ProtocolTest(args.server, args.port, args.password, shlex.split(args.server_args))
+    success = tester.run_all_tests(args.only)
+
+    return 0 if success else 1
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -101,6 +101,10 @@ run_test_suite() {
 run_python_tests() {
     print_section "Python Test Runner"
     
+    if [ -f "$TEST_DIR/protocol_tests.py" ]; then
+        python3 "$TEST_DIR/protocol_tests.py" --server "$SERVER_BINARY" || return 1
+    fi
+
     if [ -f "$TEST_DIR/test_runner.py" ]; then
         python3 "$TEST_DIR/test_runner.py" --server "$SERVER_BINARY"
         return $?